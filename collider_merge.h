@@ -0,0 +1,141 @@
+#pragma once
+
+#include <raylib.h>
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "world.h"
+
+// Result of MergeColliders: the merged level plus the mapping between merged and original colliders
+struct MergedColliders {
+    std::vector<Collider> colliders;
+    std::vector<int> mergedOf;              // Per original collider, index of the merged collider now covering it
+    std::vector<std::vector<int>> sources;  // Per merged collider, the original colliders it stands for
+};
+
+// Level load pass that greedily merges boxes whose union is itself a box, so collision and rendering pay for
+// fewer colliders. Two boxes merge when they have exactly the same extent on two axes and touch or overlap on
+// the third, and a box that lies completely inside another is absorbed by it. Either way the solid region is
+// exactly what it was. Only boxes of the same color merge (absorbed boxes are hidden anyway), so the level
+// looks the same apart from the wireframe edges between merged boxes. Boxes that weren't merged with anything
+// are copied through untouched.
+inline MergedColliders MergeColliders(const std::vector<Collider>& originals)
+{
+    struct Box {
+        Vector3 min;
+        Vector3 max;
+        Color color;
+        std::vector<int> sources;
+        bool alive = true;
+    };
+
+    std::vector<Box> boxes;
+    boxes.reserve(originals.size());
+    for (int i = 0; i < (int)originals.size(); i++) {
+        const Collider& collider = originals[i];
+        // Same bounds the resolver computes
+        boxes.push_back({collider.position - collider.dimensions * 0.5f,
+                         collider.position + collider.dimensions * 0.5f,
+                         collider.color,
+                         {i}});
+    }
+
+    auto get = [](const Vector3& v, int axis) { return axis == 0 ? v.x : axis == 1 ? v.y : v.z; };
+    auto set = [](Vector3& v, int axis, float value) { (axis == 0 ? v.x : axis == 1 ? v.y : v.z) = value; };
+    auto absorb = [](Box& into, Box& from) {
+        into.sources.insert(into.sources.end(), from.sources.begin(), from.sources.end());
+        from.sources.clear();
+        from.alive = false;
+    };
+
+    std::vector<int> order;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        order.clear();
+        for (int i = 0; i < (int)boxes.size(); i++) if (boxes[i].alive) order.push_back(i);
+
+        // Absorb boxes contained in another one. Sweep along X, only boxes starting before this one ends can contain
+        // or be contained by it.
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return boxes[a].min.x < boxes[b].min.x; });
+        for (size_t i = 0; i < order.size(); i++) {
+            Box& outer = boxes[order[i]];
+            if (!outer.alive) continue;
+            for (size_t j = i + 1; j < order.size() && boxes[order[j]].min.x <= outer.max.x; j++) {
+                Box& other = boxes[order[j]];
+                if (!other.alive) continue;
+                bool otherInside = other.min.x >= outer.min.x && other.min.y >= outer.min.y && other.min.z >= outer.min.z &&
+                                   other.max.x <= outer.max.x && other.max.y <= outer.max.y && other.max.z <= outer.max.z;
+                bool outerInside = outer.min.x >= other.min.x && outer.min.y >= other.min.y && outer.min.z >= other.min.z &&
+                                   outer.max.x <= other.max.x && outer.max.y <= other.max.y && outer.max.z <= other.max.z;
+                if (otherInside) {
+                    absorb(outer, other);
+                    changed = true;
+                } else if (outerInside) {
+                    absorb(other, outer);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+
+        // Merge along each axis: group boxes with identical extents on the other two axes (and color), then sweep
+        // each group along the axis joining boxes that touch or overlap
+        for (int axis = 0; axis < 3; axis++) {
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            order.clear();
+            for (int i = 0; i < (int)boxes.size(); i++) if (boxes[i].alive) order.push_back(i);
+
+            auto key = [&](const Box& box) {
+                return std::make_tuple(get(box.min, u), get(box.max, u), get(box.min, v), get(box.max, v),
+                                       box.color.r, box.color.g, box.color.b, box.color.a);
+            };
+            std::sort(order.begin(), order.end(), [&](int a, int b) {
+                auto ka = key(boxes[a]);
+                auto kb = key(boxes[b]);
+                if (ka != kb) return ka < kb;
+                return get(boxes[a].min, axis) < get(boxes[b].min, axis);
+            });
+
+            for (size_t i = 0; i < order.size();) {
+                Box& run = boxes[order[i]];
+                size_t j = i + 1;
+                for (; j < order.size(); j++) {
+                    Box& next = boxes[order[j]];
+                    if (key(next) != key(run)) break;
+                    if (get(next.min, axis) > get(run.max, axis)) break;
+                    set(run.max, axis, std::max(get(run.max, axis), get(next.max, axis)));
+                    absorb(run, next);
+                    changed = true;
+                }
+                i = j;
+            }
+        }
+    }
+
+    MergedColliders result;
+    result.mergedOf.assign(originals.size(), -1);
+    for (Box& box : boxes) {
+        if (!box.alive) continue;
+        int index = (int)result.colliders.size();
+        // Keep the original collider as is when the box didn't grow (nothing merged, or it only absorbed boxes inside it)
+        const Collider& first = originals[box.sources[0]];
+        Vector3 firstMin = first.position - first.dimensions * 0.5f;
+        Vector3 firstMax = first.position + first.dimensions * 0.5f;
+        if (firstMin.x == box.min.x && firstMin.y == box.min.y && firstMin.z == box.min.z &&
+            firstMax.x == box.max.x && firstMax.y == box.max.y && firstMax.z == box.max.z) {
+            result.colliders.push_back(first);
+        } else {
+            Collider merged((box.min + box.max) * 0.5f, box.max - box.min);
+            merged.color = box.color;
+            result.colliders.push_back(merged);
+        }
+        for (int source : box.sources) result.mergedOf[source] = index;
+        result.sources.push_back(std::move(box.sources));
+    }
+    return result;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "world.h"
+#include "simd.h"
+
+struct CrowdSettings {
+    float radius = 1.0f;        // Neighbours closer than this push apart and align, also the hash cell size
+    float separation = 3.0f;    // Strength of the push away from neighbours
+    float alignment = 0.3f;     // How much agents match the average velocity of their neighbours
+    float maxSpeed = 6.0f;
+};
+
+// Boids style local avoidance for the world's actors, so a crowd heading the same way spreads out instead of piling
+// into one spot. steer() runs before World::step(): it takes each actor's desired velocity (e.g. from a FlowField),
+// adds separation and alignment from its neighbours and hands the result to World::applyInput, so the usual axis by
+// axis collision resolve moves them.
+//
+// Neighbours are found with a spatial hash rebuilt every step with a counting sort: count actors per bucket, prefix
+// sum, scatter. Positions and velocities get copied in bucket order into flat arrays, so the actors of a cell are
+// contiguous and the force sums run Lanes::WIDTH neighbours at a time.
+struct Crowd {
+    CrowdSettings settings;
+    // Spatial hash: bucketStart[b]..bucketStart[b + 1] is the range of bucket b in the sorted arrays
+    std::vector<int> bucketStart;
+    std::vector<int> bucketOf;      // Per actor
+    std::vector<int> sorted;        // Actor index per slot
+    // Sorted positions and velocities on XZ, padded by Lanes::WIDTH so a full load past the end stays in bounds
+    std::vector<float> posX, posZ, velX, velZ;
+    std::vector<Vector3> steering;  // Per actor, the result of the last steer()
+
+    explicit Crowd(const CrowdSettings& settings = {}) : settings(settings) {}
+
+    int cellCoord(float v) const { return (int)floorf(v / settings.radius); }
+
+    int bucket(int cx, int cz) const {
+        // Bucket count is a power of two
+        unsigned h = (unsigned)cx * 73856093u ^ (unsigned)cz * 19349663u;
+        return (int)(h & (unsigned)(bucketStart.size() - 2));
+    }
+
+    void rebuild(const World& world) {
+        int count = (int)world.actors.size();
+        int buckets = 64;
+        while (buckets < count * 2) buckets *= 2;
+        bucketStart.assign(buckets + 1, 0);
+        bucketOf.resize(count);
+        sorted.resize(count);
+        for (std::vector<float>* values : {&posX, &posZ, &velX, &velZ}) values->assign(count + Lanes::WIDTH, 0.0f);
+
+        for (int i = 0; i < count; i++) {
+            const Vector3& p = world.actors[i].body.position;
+            bucketOf[i] = bucket(cellCoord(p.x), cellCoord(p.z));
+            bucketStart[bucketOf[i] + 1]++;
+        }
+        for (int b = 0; b < buckets; b++) bucketStart[b + 1] += bucketStart[b];
+        // Scatter, using the next bucket's start as the fill position and restoring it after
+        for (int i = 0; i < count; i++) {
+            int slot = bucketStart[bucketOf[i]]++;
+            const Actor& actor = world.actors[i];
+            sorted[slot] = i;
+            posX[slot] = actor.body.position.x;
+            posZ[slot] = actor.body.position.z;
+            velX[slot] = actor.speed.x;
+            velZ[slot] = actor.speed.z;
+        }
+        for (int b = buckets; b > 0; b--) bucketStart[b] = bucketStart[b - 1];
+        bucketStart[0] = 0;
+    }
+
+    // desired: per actor, the velocity it wants on XZ
+    void steer(World& world, const std::vector<Vector3>& desired) {
+        rebuild(world);
+        int count = (int)world.actors.size();
+        steering.resize(count);
+        const float r2 = settings.radius * settings.radius;
+        const Lanes radius2 = Lanes::set(r2);
+        const Lanes invRadius2 = Lanes::set(1.0f / r2);
+        const Lanes zero = Lanes::set(0.0f);
+        const Lanes one = Lanes::set(1.0f);
+        const Lanes lane = Lanes::index();
+
+        // In slot order, so neighbouring agents (and their neighbours' data) are handled together
+        for (int slot = 0; slot < count; slot++) {
+            int i = sorted[slot];
+            float x = posX[slot], z = posZ[slot];
+            const Lanes px = Lanes::set(x), pz = Lanes::set(z);
+            Lanes pushX = zero, pushZ = zero, sumVX = zero, sumVZ = zero, neighbours = zero;
+            int cx = cellCoord(x), cz = cellCoord(z);
+            // Different cells can share a bucket, don't count one twice
+            int visited[9];
+            int visitedCount = 0;
+            for (int dz = -1; dz <= 1; dz++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int b = bucket(cx + dx, cz + dz);
+                    if (std::find(visited, visited + visitedCount, b) != visited + visitedCount) continue;
+                    visited[visitedCount++] = b;
+                    int end = bucketStart[b + 1];
+                    for (int j = bucketStart[b]; j < end; j += Lanes::WIDTH) {
+                        Lanes offX = px - Lanes::load(&posX[j]);
+                        Lanes offZ = pz - Lanes::load(&posZ[j]);
+                        Lanes d2 = offX * offX + offZ * offZ;
+                        // Within the radius, not the agent itself (or exactly on top of it, no way to tell which
+                        // way to push then), and not past the end of the bucket
+                        Lanes inside = WhereLess(zero, d2, WhereLess(d2, radius2, WhereLess(lane, Lanes::set((float)(end - j)), one)));
+                        // Push falls off from 1/d at contact to nothing at the radius
+                        Lanes weight = inside * (one / d2 - invRadius2);
+                        pushX = pushX + WhereLess(zero, inside, offX * weight);
+                        pushZ = pushZ + WhereLess(zero, inside, offZ * weight);
+                        sumVX = sumVX + inside * Lanes::load(&velX[j]);
+                        sumVZ = sumVZ + inside * Lanes::load(&velZ[j]);
+                        neighbours = neighbours + inside;
+                    }
+                }
+            }
+
+            Vector3 want = desired[i];
+            Vector3 result = {want.x + pushX.sum() * settings.separation, 0.0f, want.z + pushZ.sum() * settings.separation};
+            float n = neighbours.sum();
+            if (n > 0.0f) {
+                result.x += (sumVX.sum() / n - velX[slot]) * settings.alignment;
+                result.z += (sumVZ.sum() / n - velZ[slot]) * settings.alignment;
+            }
+            float length = sqrtf(result.x * result.x + result.z * result.z);
+            if (length > settings.maxSpeed) result = result * (settings.maxSpeed / length);
+            steering[i] = result;
+        }
+
+        for (int i = 0; i < count; i++) world.applyInput(i, steering[i]);
+    }
+};
@@ -0,0 +1,138 @@
+// Benchmark for crowd steering
+//
+// Spreads a crowd over a large pillar level and has it chase a goal that circles the middle, steered by a FlowField
+// plus Crowd separation and alignment, then moved by World::step. Times the steering and the step per 60 Hz tick
+// against the frame budget, and counts agents standing inside each other with separation on and off. Headless.
+// Options:
+//     --agents N        crowd size (default 10000)
+//     --ticks N         simulated ticks per run (default 300)
+//     --size F          level side in units (default 160)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "world.h"
+#include "collider_merge.h"
+#include "navigation.h"
+#include "flow_field.h"
+#include "crowd.h"
+
+constexpr float TICK_DT = 1.0f / 60.0f;
+constexpr float CHASE_SPEED = 4.0f;
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Pairs of agents whose boxes overlap on XZ by more than a quarter of their width, through a plain grid
+int CountOverlaps(const World& world, float width)
+{
+    std::unordered_map<long long, std::vector<int>> cells;
+    for (int i = 0; i < (int)world.actors.size(); i++) {
+        const Vector3& p = world.actors[i].body.position;
+        cells[World::sleepCellKey((int)floorf(p.x / width), (int)floorf(p.z / width))].push_back(i);
+    }
+    float limit = width * 0.75f;
+    int overlaps = 0;
+    for (int i = 0; i < (int)world.actors.size(); i++) {
+        const Vector3& p = world.actors[i].body.position;
+        int cx = (int)floorf(p.x / width), cz = (int)floorf(p.z / width);
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                auto it = cells.find(World::sleepCellKey(cx + dx, cz + dz));
+                if (it == cells.end()) continue;
+                for (int j : it->second) {
+                    if (j <= i) continue;
+                    const Vector3& q = world.actors[j].body.position;
+                    if (fabsf(p.x - q.x) < limit && fabsf(p.z - q.z) < limit) overlaps++;
+                }
+            }
+        }
+    }
+    return overlaps;
+}
+
+int main(int argc, char** argv) {
+    int agents = 10000;
+    int ticks = 300;
+    float size = 160.0f;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--agents") == 0) agents = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--ticks") == 0) ticks = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--size") == 0) size = std::max(20.0f, (float)atof(argv[i + 1]));
+    }
+
+    float half = size * 0.5f;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> spread(-half + 1.0f, half - 1.0f);
+    std::vector<Collider> colliders = {Collider({0.0f, 0.475f, 0.0f}, {size, 0.05f, size})};
+    for (int i = 0; i < 40; i++) colliders.push_back(Collider({spread(rng), 0.5f, spread(rng)}, {1.0f, 10.0f, 1.0f}));
+    colliders = MergeColliders(colliders).colliders;
+    Player player({0.0f, 1.0f, 0.0f}, {0.5f, 1.0f, 0.5f});
+    World world(colliders, player);
+    NavGrid grid = BuildNavGrid(world, NavSettings{});
+    NavGraph graph(grid);
+    printf("level %.0fx%.0f, %d colliders, %d agents, %d ticks at 60 Hz\n", size, size, (int)colliders.size(), agents, ticks);
+
+    std::vector<Vector3> spawns;
+    while ((int)spawns.size() < agents) {
+        Vector3 p = {spread(rng), 1.0f, spread(rng)};
+        int cell = grid.cellAt(p);
+        if (cell >= 0 && grid.walkable[cell]) spawns.push_back(p);
+    }
+
+    for (bool separate : {false, true}) {
+        world.actors.clear();
+        world.awakeActors.clear();
+        world.sleepers.clear();
+        for (const Vector3& p : spawns) world.addActor(p, {0.5f, 1.0f, 0.5f});
+        FlowField field(graph);
+        CrowdSettings settings;
+        if (!separate) settings.separation = settings.alignment = 0.0f;
+        Crowd crowd(settings);
+        std::vector<Vector3> positions(agents), desired(agents);
+
+        double fieldMs = 0.0, steerMs = 0.0, stepMs = 0.0, firstMs = 0.0, worstMs = 0.0;
+        int overlapSum = 0, samples = 0;
+        for (int tick = 0; tick < ticks; tick++) {
+            float angle = (float)tick * TICK_DT * 0.3f;
+            player.position = {cosf(angle) * half * 0.3f, 1.0f, sinf(angle) * half * 0.3f};
+
+            auto tickStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < agents; i++) positions[i] = world.actors[i].body.position;
+            field.setGoal(player.position);
+            field.prepare(positions);
+            for (int i = 0; i < agents; i++) desired[i] = field.directionAt(positions[i]) * CHASE_SPEED;
+            double fieldDone = MsSince(tickStart);
+            crowd.steer(world, desired);
+            double steerDone = MsSince(tickStart);
+            world.step(TICK_DT);
+            double tickMs = MsSince(tickStart);
+            fieldMs += fieldDone;
+            steerMs += steerDone - fieldDone;
+            stepMs += tickMs - steerDone;
+            // The first tick builds the flow field under the whole crowd
+            if (tick == 0) firstMs = tickMs;
+            else worstMs = std::max(worstMs, tickMs);
+
+            if (tick % 30 == 29) {
+                overlapSum += CountOverlaps(world, 0.5f);
+                samples++;
+            }
+        }
+        printf("%-14s field %.2f ms, steer %.2f ms, step %.2f ms per tick, first %.2f ms, worst after %.2f ms of %.2f, %.0f overlapping pairs on average\n",
+            separate ? "separation:" : "no separation:", fieldMs / ticks, steerMs / ticks, stepMs / ticks, firstMs, worstMs, TICK_DT * 1000.0f,
+            samples ? (double)overlapSum / samples : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "navigation.h"
+#include "parallel.h"
+
+// Flow field towards one shared goal (usually the player), for crowds: instead of a path per agent every cell
+// stores the way to go, so steering is a lookup.
+//
+// Built on the NavGraph clusters, which double as tiles. Entrance distances come from a Dijkstra over the abstract
+// graph from the goal, which only runs as far as the tiles asked for so far need. Tiles are filled in on demand by
+// prepare(): a Dijkstra over the tile's cells seeded with the entrances through which the way to the goal leaves the
+// tile (integration field), remembering which neighbour each cell got its distance from (direction field). Tiles are
+// independent of each other, so prepare() fills them in parallel. When the goal moves, a tile whose seeds only all got
+// further or closer by the same amount keeps its fields, only its distance offset changes.
+// Going through entrances makes detours that matter close to the goal, so the tiles around the goal's tile are done
+// exactly instead, in one Dijkstra over all of them.
+struct FlowField {
+    static constexpr unsigned char NO_DIRECTION = 255;
+    static constexpr int NEAR_TILES = 1;    // Tiles around the goal's tile integrated exactly
+
+    // Where the way to the goal leaves a tile: an entrance and the node across the border, or the goal itself
+    struct Seed {
+        int cell;
+        int via;        // Cell across the border, -1 for the goal
+        float cost;
+    };
+
+    struct Tile {
+        unsigned version = 0;       // FlowField::version the tile is up to date with, 0 = never built
+        float offset = 0.0f;        // Added to the stored cell costs
+        bool near = false;          // Built as part of the area around the goal
+        std::vector<Seed> seeds;    // What it was built from
+    };
+
+    const NavGraph& graph;
+    const NavGrid& grid;
+    int goal = -1;
+    unsigned version = 0;
+    // Abstract Dijkstra from the goal, per node: distance to the goal, the node it continues to (-1: the goal) and
+    // whether it's final. frontier is kept between calls so the search can go on when more tiles are needed.
+    std::vector<float> nodeCost;
+    std::vector<int> nodeVia;
+    std::vector<unsigned> nodeSettled;
+    std::vector<std::pair<float, int>> frontier;
+    // Per cell: distance (before the tile offset) and index into NAV_DIRECTIONS of the way to go
+    std::vector<float> cost;
+    std::vector<unsigned char> direction;
+    std::vector<Tile> tiles;
+    NavRect nearRect = {0, 0, -1, -1};
+    // Counters since the last setGoal(), for tuning
+    int tilesBuilt = 0;
+    int tilesShifted = 0;
+    std::vector<int> needed;
+    std::vector<unsigned> neededStamp;
+    std::vector<std::pair<float, int>> heap;
+    std::vector<Seed> seeds;
+    PathSearch search;
+
+    explicit FlowField(const NavGraph& graph)
+        : graph(graph), grid(graph.grid),
+          nodeCost(graph.nodeCells.size(), INFINITY), nodeVia(graph.nodeCells.size(), -1), nodeSettled(graph.nodeCells.size(), 0),
+          cost(grid.walkable.size(), INFINITY), direction(grid.walkable.size(), NO_DIRECTION),
+          tiles(graph.clusterNodes.size()), neededStamp(graph.clusterNodes.size(), 0), search(graph) {}
+
+    // Moves the goal. Only does work when the goal changes cell: restarts the abstract search and redoes the area
+    // around the goal. The other tiles are brought up to date by prepare().
+    void setGoal(const Vector3& target) {
+        int cell = grid.cellAt(target);
+        if (cell >= 0 && !grid.walkable[cell]) cell = -1;
+        if (cell == goal && version != 0) return;
+        goal = cell;
+        version++;
+        tilesBuilt = 0;
+        tilesShifted = 0;
+        std::fill(nodeCost.begin(), nodeCost.end(), INFINITY);
+        std::fill(nodeVia.begin(), nodeVia.end(), -1);
+        frontier.clear();
+        nearRect = {0, 0, -1, -1};
+        if (goal < 0) return;
+
+        // The costs of the graph are symmetric, so distances from the goal are distances to it
+        std::vector<NavEdge> fromGoal;
+        search.connect(goal, fromGoal);
+        for (const NavEdge& edge : fromGoal) {
+            nodeCost[edge.to] = edge.cost;
+            frontier.push_back({edge.cost, edge.to});
+        }
+        std::make_heap(frontier.begin(), frontier.end(), PathSearch::heapOrder);
+
+        // Exact area around the goal, left through its entrances whose way goes around the outside
+        int goalTile = graph.clusterOf(goal);
+        int tileX = goalTile % graph.clustersX, tileZ = goalTile / graph.clustersX;
+        int firstX = std::max(0, tileX - NEAR_TILES), lastX = std::min(graph.clustersX - 1, tileX + NEAR_TILES);
+        int firstZ = std::max(0, tileZ - NEAR_TILES), lastZ = std::min(graph.clustersZ - 1, tileZ + NEAR_TILES);
+        NavRect first = graph.clusterRect(firstZ * graph.clustersX + firstX);
+        NavRect last = graph.clusterRect(lastZ * graph.clustersX + lastX);
+        nearRect = {first.x0, first.z0, last.x1, last.z1};
+        seeds.clear();
+        seeds.push_back({goal, -1, 0.0f});
+        for (int z = firstZ; z <= lastZ; z++) {
+            for (int x = firstX; x <= lastX; x++) {
+                int tile = z * graph.clustersX + x;
+                settle(tile);
+                for (int node : graph.clusterNodes[tile]) {
+                    int via = nodeVia[node];
+                    if (via < 0) continue;
+                    int viaCell = graph.nodeCells[via];
+                    if (!nearRect.contains(viaCell % grid.width, viaCell / grid.width)) seeds.push_back({graph.nodeCells[node], viaCell, nodeCost[node]});
+                }
+                tiles[tile] = {version, 0.0f, true, {}};
+            }
+        }
+        integrate(nearRect, seeds, heap);
+    }
+
+    // Runs the abstract search until every node of the tile has its final distance
+    void settle(int tile) {
+        auto done = [&] {
+            for (int node : graph.clusterNodes[tile]) if (nodeSettled[node] != version) return false;
+            return true;
+        };
+        while (!frontier.empty() && !done()) {
+            std::pop_heap(frontier.begin(), frontier.end(), PathSearch::heapOrder);
+            auto [distance, node] = frontier.back();
+            frontier.pop_back();
+            if (distance > nodeCost[node] || nodeSettled[node] == version) continue;
+            nodeSettled[node] = version;
+            for (const NavEdge& edge : graph.edges[node]) {
+                float total = distance + edge.cost;
+                if (total >= nodeCost[edge.to]) continue;
+                nodeCost[edge.to] = total;
+                nodeVia[edge.to] = node;
+                frontier.push_back({total, edge.to});
+                std::push_heap(frontier.begin(), frontier.end(), PathSearch::heapOrder);
+            }
+        }
+    }
+
+    // Brings the tiles under the given positions up to date, in parallel
+    void prepare(const std::vector<Vector3>& positions, int threads = 0) {
+        needed.clear();
+        for (const Vector3& position : positions) {
+            int cell = grid.cellAt(position);
+            if (cell < 0) continue;
+            int tile = graph.clusterOf(cell);
+            if (tiles[tile].version == version || neededStamp[tile] == version) continue;
+            neededStamp[tile] = version;
+            needed.push_back(tile);
+        }
+        update(threads);
+    }
+
+    // Brings every tile up to date
+    void prepareAll(int threads = 0) {
+        needed.clear();
+        for (int tile = 0; tile < (int)tiles.size(); tile++) if (tiles[tile].version != version) needed.push_back(tile);
+        update(threads);
+    }
+
+    void update(int threads) {
+        if (goal < 0) return;
+        // The abstract search isn't thread safe, finish what the tiles need first
+        for (int tile : needed) settle(tile);
+        std::vector<int> built(needed.size(), 0);
+        ParallelFor((int)needed.size(), threads, [&](int begin, int end) {
+            std::vector<std::pair<float, int>> tileHeap;
+            std::vector<Seed> tileSeeds;
+            for (int i = begin; i < end; i++) built[i] = updateTile(needed[i], tileHeap, tileSeeds);
+        }, 4);
+        for (int wasBuilt : built) (wasBuilt ? tilesBuilt : tilesShifted)++;
+    }
+
+    // Returns true if the tile had to be built, false if shifting it was enough
+    bool updateTile(int tile, std::vector<std::pair<float, int>>& tileHeap, std::vector<Seed>& tileSeeds) {
+        Tile& state = tiles[tile];
+        tileSeeds.clear();
+        for (int node : graph.clusterNodes[tile]) {
+            int via = nodeVia[node];
+            if (via < 0) continue;
+            int viaCell = graph.nodeCells[via];
+            if (graph.clusterOf(viaCell) != tile) tileSeeds.push_back({graph.nodeCells[node], viaCell, nodeCost[node]});
+        }
+
+        // Same seeds, all moved by the same amount: the same cells win, only the distances shift
+        if (state.version != 0 && !state.near && tileSeeds.size() == state.seeds.size()) {
+            bool same = true;
+            float shift = tileSeeds.empty() ? 0.0f : tileSeeds[0].cost - state.seeds[0].cost;
+            for (size_t i = 0; i < tileSeeds.size() && same; i++) {
+                same = tileSeeds[i].cell == state.seeds[i].cell && tileSeeds[i].via == state.seeds[i].via &&
+                       fabsf(tileSeeds[i].cost - state.seeds[i].cost - shift) < 1e-3f;
+            }
+            if (same) {
+                state.offset += shift;
+                state.version = version;
+                return false;
+            }
+        }
+
+        integrate(graph.clusterRect(tile), tileSeeds, tileHeap);
+        state.seeds = tileSeeds;
+        state.offset = 0.0f;
+        state.near = false;
+        state.version = version;
+        return true;
+    }
+
+    // Dijkstra from the seeds over the cells of rect, filling in cost and direction there
+    void integrate(const NavRect& rect, const std::vector<Seed>& from, std::vector<std::pair<float, int>>& open) {
+        for (int z = rect.z0; z <= rect.z1; z++) {
+            std::fill(cost.begin() + (size_t)z * grid.width + rect.x0, cost.begin() + (size_t)z * grid.width + rect.x1 + 1, INFINITY);
+            std::fill(direction.begin() + (size_t)z * grid.width + rect.x0, direction.begin() + (size_t)z * grid.width + rect.x1 + 1, NO_DIRECTION);
+        }
+        open.clear();
+        for (const Seed& seed : from) {
+            if (seed.cost >= cost[seed.cell]) continue;
+            cost[seed.cell] = seed.cost;
+            open.push_back({seed.cost, seed.cell});
+            // Seeds other than the goal point out of the area, to the entrance on the other side
+            direction[seed.cell] = seed.via < 0 ? NO_DIRECTION : directionTo(seed.cell, seed.via);
+        }
+        std::make_heap(open.begin(), open.end(), PathSearch::heapOrder);
+        while (!open.empty()) {
+            std::pop_heap(open.begin(), open.end(), PathSearch::heapOrder);
+            auto [distance, cell] = open.back();
+            open.pop_back();
+            if (distance > cost[cell]) continue;
+            int x = cell % grid.width, z = cell / grid.width;
+            for (int d = 0; d < 8; d++) {
+                int dx = NAV_DIRECTIONS[d][0], dz = NAV_DIRECTIONS[d][1];
+                if (!rect.contains(x + dx, z + dz) || !grid.canMove(x, z, dx, dz)) continue;
+                int next = cell + dz * grid.width + dx;
+                float total = distance + (dx != 0 && dz != 0 ? NAV_DIAGONAL_COST : 1.0f);
+                if (total >= cost[next]) continue;
+                cost[next] = total;
+                // Moves are symmetric, the way back is the opposite direction
+                direction[next] = (unsigned char)(d ^ 1);
+                open.push_back({total, next});
+                std::push_heap(open.begin(), open.end(), PathSearch::heapOrder);
+            }
+        }
+    }
+
+    unsigned char directionTo(int from, int to) const {
+        int dx = to % grid.width - from % grid.width;
+        int dz = to / grid.width - from / grid.width;
+        for (int d = 0; d < 8; d++) if (NAV_DIRECTIONS[d][0] == dx && NAV_DIRECTIONS[d][1] == dz) return (unsigned char)d;
+        return NO_DIRECTION;
+    }
+
+    // Cell an agent at position should steer by: its own, or the best open neighbour when it stands in a blocked
+    // cell (pushed into the clearance around an obstacle). -1 when there's nothing up to date to go by.
+    int steeringCell(const Vector3& position) const {
+        int cell = grid.cellAt(position);
+        if (cell < 0) return -1;
+        if (grid.walkable[cell]) return tiles[graph.clusterOf(cell)].version == version ? cell : -1;
+        int best = -1;
+        float bestCost = INFINITY;
+        int x = cell % grid.width, z = cell / grid.width;
+        for (const auto& d : NAV_DIRECTIONS) {
+            if (!grid.open(x + d[0], z + d[1])) continue;
+            int next = cell + d[1] * grid.width + d[0];
+            float distance = distanceAt(next);
+            if (distance < bestCost) {
+                bestCost = distance;
+                best = next;
+            }
+        }
+        return best;
+    }
+
+    float distanceAt(int cell) const {
+        const Tile& tile = tiles[graph.clusterOf(cell)];
+        return tile.version == version ? cost[cell] + tile.offset : INFINITY;
+    }
+
+    // Unit direction on XZ to move in from position, zero at the goal or where there's no way to it
+    Vector3 directionAt(const Vector3& position) const {
+        int cell = grid.cellAt(position);
+        int from = steeringCell(position);
+        if (from < 0) return {0.0f, 0.0f, 0.0f};
+        if (from != cell) return Vector3Normalize({grid.center(from).x - position.x, 0.0f, grid.center(from).z - position.z});
+        unsigned char d = direction[cell];
+        if (d == NO_DIRECTION) return {0.0f, 0.0f, 0.0f};
+        float scale = NAV_DIRECTIONS[d][0] != 0 && NAV_DIRECTIONS[d][1] != 0 ? 0.70710678f : 1.0f;
+        return {(float)NAV_DIRECTIONS[d][0] * scale, 0.0f, (float)NAV_DIRECTIONS[d][1] * scale};
+    }
+
+    // Walking distance to the goal in cells, INFINITY if unreachable or not prepared
+    float distanceAt(const Vector3& position) const {
+        int cell = steeringCell(position);
+        return cell < 0 ? INFINITY : distanceAt(cell);
+    }
+};
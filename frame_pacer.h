@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <cerrno>
+#include <time.h>
+#endif
+
+// Paces the main loop to a fixed frame rate with absolute deadlines, so lateness in one frame doesn't push
+// every following frame back. Sleeps until shortly before the deadline (clock_nanosleep on Linux, which wakes
+// up accurately enough for that) and spins the rest of the way, since OS sleeps routinely overshoot by a
+// fraction of a millisecond. Use it with SetTargetFPS(0) so raylib doesn't wait on top of it; the time spent
+// here still ends up in the next GetFrameTime().
+struct FramePacer {
+    // Default spin tail, long enough to cover the usual sleep overshoot
+    static constexpr long long SPIN_NS = 1'000'000;
+    // Number of frame intervals kept for the statistics
+    static constexpr size_t MAX_SAMPLES = 16384;
+
+    int targetFps = 0;          // 0 means uncapped
+    long long periodNs = 0;
+    long long spinNs = SPIN_NS;
+    long long deadline = 0;
+    long long lastFrame = 0;
+    // Frame intervals in ns, used as a ring once full
+    std::vector<long long> intervals;
+    size_t nextSample = 0;
+    long long frames = 0;           // Every interval recorded, the ring only keeps the last MAX_SAMPLES
+    long long missedDeadlines = 0;
+    long long lastThrottled = 0;
+
+    explicit FramePacer(int fps = 60) { setTarget(fps); }
+
+    static long long nowNs() {
+#if defined(__linux__)
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (long long)ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static void sleepUntilNs(long long t) {
+#if defined(__linux__)
+        timespec ts;
+        ts.tv_sec = (time_t)(t / 1'000'000'000LL);
+        ts.tv_nsec = (long)(t % 1'000'000'000LL);
+        // Restart if a signal interrupts the sleep, the deadline is absolute so nothing drifts
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#else
+        std::this_thread::sleep_for(std::chrono::nanoseconds(t - nowNs()));
+#endif
+    }
+
+    void setTarget(int fps) {
+        targetFps = fps;
+        periodNs = fps > 0 ? 1'000'000'000LL / fps : 0;
+        deadline = 0;
+        intervals.clear();
+        nextSample = 0;
+        frames = 0;
+        missedDeadlines = 0;
+    }
+
+    // Forget the previous deadline and frame, e.g. after time spent on an idle screen that shouldn't count
+    void resync() {
+        deadline = 0;
+        lastFrame = 0;
+    }
+
+    // Caps frames that aren't paced or counted by wait(), like an idle screen woken up by events, at the target
+    // rate, or at 60 FPS when uncapped
+    void throttle() {
+        long long period = periodNs > 0 ? periodNs : 1'000'000'000LL / 60;
+        long long now = nowNs();
+        if (lastThrottled != 0 && now < lastThrottled + period) {
+            sleepUntilNs(lastThrottled + period);
+            now = nowNs();
+        }
+        lastThrottled = now;
+    }
+
+    // Call once per frame, right after EndDrawing()
+    void wait() {
+        wait([] {});
+    }
+
+    // Same, but calls poll() every pollNs while sleeping (e.g. to pick up input between frames).
+    // The spin tail at the end isn't interrupted.
+    template<typename Poll>
+    void wait(Poll&& poll, long long pollNs = 1'000'000) {
+        long long now = nowNs();
+        if (periodNs > 0) {
+            if (deadline == 0) deadline = now + periodNs;
+            if (now < deadline) {
+                while (deadline - now > spinNs) {
+                    sleepUntilNs(std::min(now + pollNs, deadline - spinNs));
+                    poll();
+                    now = nowNs();
+                }
+                while ((now = nowNs()) < deadline) {}
+                deadline += periodNs;
+            } else {
+                // Too late for this one, start counting again from now instead of trying to catch up
+                missedDeadlines++;
+                deadline = now + periodNs;
+            }
+        }
+        if (lastFrame != 0) record(now - lastFrame);
+        lastFrame = now;
+    }
+
+    void record(long long interval) {
+        frames++;
+        if (intervals.size() < MAX_SAMPLES) {
+            intervals.push_back(interval);
+        } else {
+            intervals[nextSample] = interval;
+            nextSample = (nextSample + 1) % MAX_SAMPLES;
+        }
+    }
+
+    // Value at percentile p (0-100) of samples, which gets reordered
+    static double percentile(std::vector<double>& samples, double p) {
+        if (samples.empty()) return 0.0;
+        size_t index = std::min(samples.size() - 1, (size_t)(p / 100.0 * (double)samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + (long)index, samples.end());
+        return samples[index];
+    }
+
+    // Prints frame interval and jitter (distance from the target interval) percentiles in milliseconds. Frames and
+    // missed deadlines count since the start, the percentiles cover the last MAX_SAMPLES frames.
+    void report(FILE* out = stdout) const {
+        if (intervals.empty()) return;
+        std::vector<double> ms;
+        std::vector<double> jitter;
+        double sum = 0.0;
+        for (long long interval : intervals) {
+            double v = (double)interval / 1e6;
+            ms.push_back(v);
+            sum += v;
+            if (periodNs > 0) jitter.push_back(fabs((double)(interval - periodNs) / 1e6));
+        }
+        double maxMs = *std::max_element(ms.begin(), ms.end());
+        fprintf(out, "Frame pacing: target %s, %lld frames, %lld missed deadlines, percentiles over the last %zu frames\n",
+            targetFps > 0 ? std::to_string(targetFps).c_str() : "uncapped", frames, missedDeadlines, ms.size());
+        fprintf(out, "  interval ms: mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+            sum / (double)ms.size(), percentile(ms, 50), percentile(ms, 90), percentile(ms, 99), percentile(ms, 99.9), maxMs);
+        if (!jitter.empty()) {
+            fprintf(out, "  jitter ms:   p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+                percentile(jitter, 50), percentile(jitter, 90), percentile(jitter, 99), percentile(jitter, 99.9),
+                *std::max_element(jitter.begin(), jitter.end()));
+        }
+    }
+};
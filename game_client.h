@@ -0,0 +1,188 @@
+#pragma once
+
+#include <raylib.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "net.h"
+#include "snapshot.h"
+#include "frame_pacer.h"
+
+constexpr int CLIENT_INPUT_REDUNDANCY = 3;      // Inputs repeated in every packet, covers this many lost in a row
+constexpr long long CLIENT_HELLO_INTERVAL_NS = 100'000'000LL;
+
+constexpr int CLIENT_SNAPSHOT_HISTORY = 64;      // Same as the server's, anything it can encode against is kept
+
+// Client end of the GameServer protocol: says hello until welcomed, sends one input per tick and puts the
+// snapshots back together and decodes them. Non-blocking, except for connect() which waits for the welcome.
+struct GameClient {
+    UdpSocket socket;
+    NetAddress server;
+    bool spectator = false;     // Watch instead of play. A spectator has to sendHello() about once a second to stay on.
+    bool welcomed = false;
+    uint16_t id = 0;
+    unsigned seed = 0;
+    float groundSize = 30.0f;
+    int tickRate = 0;
+    uint32_t sequence = 0;
+    PlayerInput recent[CLIENT_INPUT_REDUNDANCY];    // Newest first
+    // Last decoded snapshot
+    uint32_t stateTick = 0;
+    uint32_t acknowledged = 0;  // Newest of our inputs the server had simulated at stateTick
+    std::vector<EntityState> players;   // Everything the server has us see, ourselves included
+    // The server's answer to our newest E press: the entity it reached, 0 for nobody
+    uint32_t talkSequence = 0;
+    uint16_t talkingTo = 0;
+    int snapshots = 0;
+    int undecodable = 0;        // Complete snapshots whose baseline we didn't have
+    SnapshotCodec codec;
+    SnapshotHistory history{CLIENT_SNAPSHOT_HISTORY};
+    // Parts of the snapshot being received
+    uint32_t buildingTick = 0;
+    uint32_t buildingBaseline = 0;
+    uint32_t buildingAck = 0;
+    int buildingParts = 0;
+    int buildingSize = 0;
+    int partsSeen = 0;
+    bool partSeen[256] = {};
+    std::vector<uint8_t> building = std::vector<uint8_t>(NET_MAX_SNAPSHOT);
+    long long bytesIn = 0, bytesOut = 0;
+
+    bool open(const NetAddress& address, bool loopback = false) {
+        server = address;
+        return socket.open(0, loopback);
+    }
+
+    void sendHello() {
+        uint8_t data[8];
+        NetWriter writer(data, sizeof(data));
+        writer.put(spectator ? NetMessage::Spectate : NetMessage::Hello);
+        writer.put(NET_PROTOCOL_VERSION);
+        if (socket.send(server, data, writer.size)) bytesOut += writer.size;
+    }
+
+    // Says hello until the server answers or the time runs out
+    bool connect(long long timeoutNs) {
+        long long deadline = FramePacer::nowNs() + timeoutNs;
+        while (!welcomed && FramePacer::nowNs() < deadline) {
+            sendHello();
+            long long retry = FramePacer::nowNs() + CLIENT_HELLO_INTERVAL_NS;
+            while (!welcomed && FramePacer::nowNs() < retry) {
+                poll();
+                FramePacer::sleepUntilNs(FramePacer::nowNs() + 1'000'000);
+            }
+        }
+        return welcomed;
+    }
+
+    void disconnect() {
+        if (!welcomed) return;
+        uint8_t type = (uint8_t)NetMessage::Bye;
+        socket.send(server, &type, 1);
+        welcomed = false;
+    }
+
+    // moveX/moveZ: desired horizontal velocity. Returns the input as sent, with its sequence number.
+    PlayerInput sendInput(float moveX, float moveZ, bool jump, bool interact = false) {
+        for (int i = CLIENT_INPUT_REDUNDANCY - 1; i > 0; i--) recent[i] = recent[i - 1];
+        recent[0] = {++sequence, moveX, moveZ, (uint8_t)jump, (uint8_t)interact};
+        uint8_t data[80];
+        NetWriter writer(data, sizeof(data));
+        writer.put(NetMessage::Input);
+        writer.put(stateTick);
+        int count = (int)std::min<uint32_t>(sequence, CLIENT_INPUT_REDUNDANCY);
+        writer.put((uint8_t)count);
+        for (int i = 0; i < count; i++) WriteInput(writer, recent[i]);
+        if (socket.send(server, data, writer.size)) bytesOut += writer.size;
+        return recent[0];
+    }
+
+    // Reads every waiting packet, returns true if a new snapshot is complete
+    bool poll() {
+        uint8_t data[NET_MAX_PACKET];
+        NetAddress from;
+        int size;
+        bool updated = false;
+        while ((size = socket.receive(data, sizeof(data), from)) >= 0) {
+            if (!(from == server)) continue;
+            bytesIn += size;
+            NetReader reader(data, size);
+            NetMessage type = reader.get<NetMessage>();
+            if (type == NetMessage::Welcome) {
+                uint16_t newId = reader.get<uint16_t>();
+                uint32_t newSeed = reader.get<uint32_t>();
+                uint16_t size = reader.get<uint16_t>();
+                uint16_t rate = reader.get<uint16_t>();
+                if (reader.failed) continue;
+                id = newId;
+                seed = newSeed;
+                groundSize = (float)size;
+                tickRate = rate;
+                codec.settings.tickRate = rate;
+                welcomed = true;
+            } else if (type == NetMessage::State) {
+                uint32_t tick = reader.get<uint32_t>();
+                uint32_t baseline = reader.get<uint32_t>();
+                uint32_t ack = reader.get<uint32_t>();
+                int part = reader.get<uint8_t>();
+                int parts = reader.get<uint8_t>();
+                if (reader.failed || part >= parts || tick <= stateTick || tick < buildingTick) continue;
+                if (tick != buildingTick) {
+                    // A newer snapshot started, whatever is left of the previous one is lost
+                    buildingTick = tick;
+                    buildingBaseline = baseline;
+                    buildingAck = ack;
+                    buildingParts = parts;
+                    buildingSize = 0;
+                    partsSeen = 0;
+                    std::fill(partSeen, partSeen + parts, false);
+                }
+                if (parts != buildingParts || partSeen[part]) continue;
+                int size = reader.remaining();
+                if (part < parts - 1 ? size != NET_STATE_PIECE : size > NET_STATE_PIECE) continue;
+                partSeen[part] = true;
+                memcpy(building.data() + part * NET_STATE_PIECE, data + reader.offset, size);
+                if (part == parts - 1) buildingSize = part * NET_STATE_PIECE + size;
+                if (++partsSeen < parts) continue;
+                updated |= decode();
+            } else if (type == NetMessage::Talk) {
+                uint32_t talked = reader.get<uint32_t>();
+                uint16_t entity = reader.get<uint16_t>();
+                if (reader.failed || talked <= talkSequence) continue;
+                talkSequence = talked;
+                talkingTo = entity;
+            } else if (type == NetMessage::Bye) {
+                welcomed = false;
+            }
+        }
+        return updated;
+    }
+
+    // Decodes the snapshot just put together, false if its baseline is gone
+    bool decode() {
+        const Snapshot* baseline = history.find(buildingBaseline);
+        if (buildingBaseline != 0 && (!baseline || baseline->tick % CLIENT_SNAPSHOT_HISTORY == buildingTick % CLIENT_SNAPSHOT_HISTORY)) {
+            undecodable++;
+            return false;
+        }
+        Snapshot& snapshot = history.start(buildingTick);
+        if (!codec.decode(building.data(), buildingSize, baseline, snapshot)) {
+            snapshot.tick = 0;
+            undecodable++;
+            return false;
+        }
+        stateTick = buildingTick;
+        acknowledged = buildingAck;
+        players.clear();
+        for (const QuantizedEntity& entity : snapshot.entities) players.push_back(Dequantize(entity, codec.settings));
+        snapshots++;
+        return true;
+    }
+
+    // Our own entry in the last snapshot, null until the server sent one
+    const EntityState* self() const {
+        for (const EntityState& player : players) if (player.id == id) return &player;
+        return nullptr;
+    }
+};
@@ -0,0 +1,152 @@
+// Headless authoritative game server
+//
+// Runs the level's simulation at SERVER_TICK_RATE on fixed deadlines and serves test_game clients started with
+// --connect host:port. Prints a line of load statistics every few seconds. With --matches it hosts that many
+// independent matches on consecutive ports, ticked by a thread pool (see MatchHost).
+// Options:
+//     --port N          UDP port (default 7777), the first one with --matches
+//     --matches N       independent matches to host (default 1)
+//     --threads N       threads ticking them (default: one per hardware thread)
+//     --seed N          level seed (default: time)
+//     --size N          side of the ground plate (default 30)
+//     --npcs N          server driven actors wandering the level (default 0)
+//     --no-interest     send every client everything, every snapshot
+//     --spectator-delay N   seconds spectators are kept behind the match (default 0)
+//     --keyframes N     seconds between full snapshots for spectators (default 2)
+//     --ticks N         stop after N ticks (default: run forever)
+
+#include <raylib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+
+#include "game_server.h"
+#include "match_host.h"
+#include "frame_pacer.h"
+
+// Many matches on a MatchHost, reporting every few seconds until maxTicks worth of time has passed
+int RunMatches(MatchHost& host, long long maxTicks)
+{
+    host.start();
+    const int reportSeconds = 5;
+    long long start = FramePacer::nowNs();
+    for (long long report = 1; maxTicks == 0 || report * reportSeconds * SERVER_TICK_RATE <= maxTicks; report++) {
+        FramePacer::sleepUntilNs(start + report * reportSeconds * 1'000'000'000LL);
+        MatchStats stats = host.collect();
+        double ticks = (double)std::max(stats.ticks, 1LL);
+        printf("%d matches, %d clients, %.0f ticks/s, tick %.3f ms average, %.3f ms worst, %.3f ms late on average, "
+               "%.2f%% overruns, %lld skips, %.1f%% of %d threads busy, %.1f kB/s out\n",
+            (int)host.matches.size(), stats.clients, (double)stats.ticks / reportSeconds, stats.busyMs / ticks, stats.worstMs,
+            stats.lateMs / ticks, 100.0 * (double)stats.overruns / ticks, stats.skipped,
+            stats.busyMs / (reportSeconds * 10.0 * host.threadCount), host.threadCount,
+            (double)stats.bytesOut / reportSeconds / 1000.0);
+        fflush(stdout);
+    }
+    host.stop();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int port = NET_DEFAULT_PORT;
+    unsigned seed = (unsigned)time(nullptr);
+    float size = 30.0f;
+    int npcs = 0;
+    bool interest = true;
+    int matches = 1;
+    int threads = 0;
+    double spectatorDelay = 0.0, keyframeSeconds = 2.0;
+    long long maxTicks = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-interest") == 0) interest = false;
+        if (i + 1 >= argc) continue;
+        if (strcmp(argv[i], "--port") == 0) port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--matches") == 0) matches = std::clamp(atoi(argv[i + 1]), 1, 10000);
+        else if (strcmp(argv[i], "--threads") == 0) threads = std::max(0, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--seed") == 0) seed = (unsigned)strtoul(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "--size") == 0) size = std::clamp((float)atof(argv[i + 1]), 10.0f, 4000.0f);
+        else if (strcmp(argv[i], "--npcs") == 0) npcs = std::clamp(atoi(argv[i + 1]), 0, SERVER_MAX_ENTITIES - 1);
+        else if (strcmp(argv[i], "--spectator-delay") == 0) spectatorDelay = std::clamp(atof(argv[i + 1]), 0.0, 600.0);
+        else if (strcmp(argv[i], "--keyframes") == 0) keyframeSeconds = std::clamp(atof(argv[i + 1]), 0.1, 60.0);
+        else if (strcmp(argv[i], "--ticks") == 0) maxTicks = atoll(argv[i + 1]);
+    }
+
+    auto setUp = [&](GameServer& server, unsigned matchSeed, int matchPort) {
+        server.interest.enabled = interest;
+        const double snapshotsPerSecond = (double)SERVER_TICK_RATE / SERVER_SEND_INTERVAL;
+        server.spectators.settings.delaySnapshots = (int)(spectatorDelay * snapshotsPerSecond + 0.5);
+        server.spectators.settings.keyframeInterval = std::max(1, (int)(keyframeSeconds * snapshotsPerSecond + 0.5));
+        std::mt19937 rng(matchSeed);
+        std::uniform_real_distribution<float> spread(-size * 0.5f + 2.0f, size * 0.5f - 2.0f);
+        for (int i = 0; i < npcs; i++) server.addNpc({spread(rng), 1.0f, spread(rng)});
+        if (server.listen((uint16_t)matchPort)) return true;
+        fprintf(stderr, "Can't listen on UDP port %d\n", matchPort);
+        return false;
+    };
+
+    if (matches > 1) {
+        MatchHost host(threads);
+        for (int m = 0; m < matches; m++) {
+            GameServer& server = host.add(std::make_unique<GameServer>(seed + (unsigned)m, size));
+            if (!setUp(server, seed + (unsigned)m, port == 0 ? 0 : port + m)) return 1;
+        }
+        printf("Serving %d matches (levels %u to %u, %.0f x %.0f, %d NPCs each) on UDP ports %d to %d at %d Hz, %d threads\n",
+            matches, seed, seed + (unsigned)matches - 1, size, size, npcs, host.matches.front()->server->socket.localPort(),
+            host.matches.back()->server->socket.localPort(), SERVER_TICK_RATE, host.threadCount);
+        fflush(stdout);
+        return RunMatches(host, maxTicks);
+    }
+
+    GameServer server(seed, size);
+    if (!setUp(server, seed, port)) return 1;
+    printf("Serving level %u (%.0f x %.0f, %d NPCs) on UDP port %d at %d Hz\n", seed, size, size, (int)server.npcs.size(),
+        server.socket.localPort(), SERVER_TICK_RATE);
+    fflush(stdout);
+
+    const long long tickNs = 1'000'000'000LL / SERVER_TICK_RATE;
+    const int reportTicks = 5 * SERVER_TICK_RATE;
+    long long deadline = FramePacer::nowNs();
+    double busyMs = 0.0, worstMs = 0.0;
+    long long overruns = 0, lastBytesOut = 0, lastInView = 0, lastRefreshed = 0, lastInteractions = 0;
+    double lastReplicationMs = 0.0;
+    for (long long tick = 1; maxTicks == 0 || tick <= maxTicks; tick++) {
+        long long start = FramePacer::nowNs();
+        server.receive();
+        server.tick();
+        double ms = (double)(FramePacer::nowNs() - start) / 1e6;
+        busyMs += ms;
+        worstMs = std::max(worstMs, ms);
+
+        if (tick % reportTicks == 0) {
+            double seconds = (double)reportTicks / SERVER_TICK_RATE;
+            double snapshots = seconds * SERVER_TICK_RATE / SERVER_SEND_INTERVAL * (double)std::max<size_t>(server.clients.size(), 1);
+            printf("%d clients, %d spectators, tick %.3f ms average (%.3f ms replication), %.3f ms worst, %.1f%% busy, %lld overruns, %.1f kB/s out, "
+                   "%.1f entities in view and %.1f refreshed per snapshot, %lld interactions\n",
+                (int)server.clients.size(), (int)server.spectators.spectators.size(), busyMs / reportTicks, (server.replicationMs - lastReplicationMs) / reportTicks, worstMs,
+                busyMs / (seconds * 10.0), overruns, (double)(server.bytesOut - lastBytesOut) / seconds / 1000.0,
+                (double)(server.entitiesInView - lastInView) / snapshots, (double)(server.entitiesRefreshed - lastRefreshed) / snapshots,
+                server.interactions - lastInteractions);
+            fflush(stdout);
+            busyMs = worstMs = 0.0;
+            overruns = 0;
+            lastBytesOut = server.bytesOut;
+            lastInView = server.entitiesInView;
+            lastRefreshed = server.entitiesRefreshed;
+            lastInteractions = server.interactions;
+            lastReplicationMs = server.replicationMs;
+        }
+
+        deadline += tickNs;
+        long long now = FramePacer::nowNs();
+        if (now > deadline) {
+            // Late, start counting from now rather than running a burst of ticks to catch up
+            overruns++;
+            deadline = now;
+        } else {
+            FramePacer::sleepUntilNs(deadline);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,490 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "world.h"
+#include "level.h"
+#include "net.h"
+#include "player_controller.h"
+#include "snapshot.h"
+#include "interest.h"
+#include "lag_compensation.h"
+#include "spectator.h"
+
+constexpr int SERVER_TICK_RATE = 120;
+constexpr float SERVER_TICK_DT = 1.0f / (float)SERVER_TICK_RATE;
+constexpr int SERVER_SEND_INTERVAL = 2;         // Ticks between state broadcasts, 60 Hz
+constexpr int SERVER_CLIENT_TIMEOUT = 3 * SERVER_TICK_RATE;
+constexpr int SERVER_SPECTATOR_TIMEOUT = 5 * SERVER_TICK_RATE;
+constexpr int SERVER_MAX_PENDING_INPUTS = 16;   // A client further ahead than this loses its oldest inputs
+constexpr float PLAYER_RESPAWN_HEIGHT = -20.0f; // Fell off the level
+constexpr int SERVER_SNAPSHOT_HISTORY = 64;     // Ticks a client's acknowledged snapshot stays usable as a baseline
+constexpr int SERVER_MAX_ENTITIES = 65535;      // Entity ids are actor index + 1 in a u16
+constexpr float NPC_WALK_SPEED = 3.0f;
+constexpr float SERVER_TALK_RANGE = 1.5f;       // How far from a player's box an E press reaches
+
+// An input waiting to be applied, with the snapshot the client had decoded when it sent the packet it came in
+struct QueuedInput {
+    PlayerInput input;
+    uint32_t viewTick = 0;
+};
+
+struct ServerClient {
+    NetAddress address;
+    uint16_t id = 0;                // Entity id of its actor
+    int actor = -1;
+    uint32_t lastQueued = 0;        // Newest input sequence received
+    uint32_t lastApplied = 0;       // Newest input sequence simulated, acknowledged in every state packet
+    uint32_t lastHeard = 0;         // Server tick
+    uint32_t ackedSnapshot = 0;     // Newest snapshot the client has decoded, the baseline for the next one
+    uint32_t viewTick = 0;          // Snapshot the client was looking at when it sent the input being applied
+    uint16_t talkingTo = 0;         // Entity its last E press reached, 0 if none. Sent back in a Talk.
+    PlayerInput current;
+    std::vector<QueuedInput> pending;   // Oldest first, one is applied per tick
+    SnapshotHistory sent{SERVER_SNAPSHOT_HISTORY};  // What this client was sent lately, its view of the world
+    ClientInterest view;
+};
+
+// Authoritative server: runs the level's World at a fixed tick with one actor per connected client plus any server
+// driven ones (NPCs), applying one queued input per client per tick. Every client gets its own snapshots, delta
+// compressed against the last one it acknowledged and limited to what's around it (see selectFor()). Call receive()
+// then tick() once per SERVER_TICK_DT. Not movable, the World points into the level.
+struct GameServer {
+    unsigned seed;
+    float groundSize;
+    Level level;
+    Player idle;                    // World wants a player, the clients are actors
+    World world;
+    UdpSocket socket;
+    std::vector<ServerClient> clients;
+    std::unordered_map<uint64_t, int> clientAt;  // Address key -> index into clients
+    std::vector<int> freeActors;    // Actors of disconnected clients, reused for new ones
+    std::vector<int> npcs;          // Actors wandering about on their own
+    std::mt19937 npcRng;
+    uint32_t tickCount = 0;
+    // Traffic since start
+    long long packetsIn = 0, packetsOut = 0, bytesIn = 0, bytesOut = 0;
+    // Replication since start: entities in the snapshots sent, those of them refreshed, time spent on it
+    long long entitiesInView = 0, entitiesRefreshed = 0;
+    double replicationMs = 0.0;
+    long long interactions = 0;     // E presses that reached someone
+    LagCompensation lagCompensation;
+    std::vector<RewindHit> rewound;
+    InterestSettings interest;
+    SpectatorChannel spectators;
+    InterestGrid grid;
+    SnapshotCodec codec;
+    // Scratch for broadcast()
+    std::vector<int> entityActors;
+    std::vector<Vector3> entityPositions;
+    std::vector<int> candidates, visitedBuckets;
+    struct Candidate {
+        QuantizedEntity fresh;
+        const QuantizedEntity* base;    // In the client's baseline, null if it doesn't have it
+        float priority;
+        bool mustSend;
+    };
+    std::vector<Candidate> considered;
+    std::vector<int> contenders;
+    ClientInterest nextView;
+    std::vector<uint8_t> encoded, packet;
+
+    explicit GameServer(unsigned seed, float groundSize = 30.0f)
+        : seed(seed), groundSize(groundSize), level(GenerateLevel(seed, groundSize)), idle({0.0f, -1000.0f, 0.0f}, PLAYER_DIMENSIONS),
+          world(level.colliders, idle), npcRng(seed) {
+        world.terrain = &level.hills;
+        codec.settings.tickRate = SERVER_TICK_RATE;
+        spectators.codec.settings.tickRate = SERVER_TICK_RATE;
+        encoded.resize(NET_MAX_SNAPSHOT);
+        packet.resize(NET_MAX_PACKET);
+    }
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    bool listen(uint16_t port, bool loopback = false) { return socket.open(port, loopback); }
+
+    static uint64_t addressKey(const NetAddress& address) { return (uint64_t)address.ip << 16 | address.port; }
+
+    void send(const NetAddress& to, int size) {
+        if (socket.send(to, packet.data(), size)) {
+            packetsOut++;
+            bytesOut += size;
+        }
+    }
+
+    // id: the entity the client plays, 0 for a spectator
+    void sendWelcome(const NetAddress& to, uint16_t id) {
+        NetWriter writer(packet.data(), (int)packet.size());
+        writer.put(NetMessage::Welcome);
+        writer.put(id);
+        writer.put((uint32_t)seed);
+        writer.put((uint16_t)groundSize);
+        writer.put((uint16_t)SERVER_TICK_RATE);
+        send(to, writer.size);
+    }
+
+    // What the client's last E press reached, so it only greets whoever the server agrees it was next to
+    void sendTalk(const ServerClient& client) {
+        NetWriter writer(packet.data(), (int)packet.size());
+        writer.put(NetMessage::Talk);
+        writer.put(client.current.sequence);
+        writer.put(client.talkingTo);
+        send(client.address, writer.size);
+    }
+
+    void connect(const NetAddress& address) {
+        if (freeActors.empty() && world.actors.size() >= (size_t)SERVER_MAX_ENTITIES) return;
+        ServerClient client;
+        client.address = address;
+        client.lastHeard = tickCount;
+        if (!freeActors.empty()) {
+            client.actor = freeActors.back();
+            freeActors.pop_back();
+        } else {
+            client.actor = world.addActor(level.spawn, PLAYER_DIMENSIONS);
+        }
+        client.id = (uint16_t)(client.actor + 1);
+        Actor& actor = world.actors[client.actor];
+        // Spread arrivals a little so they don't all stand in one box
+        actor.body.position = level.spawn + Vector3{(float)(client.id % 8) * 0.75f - 2.625f, 0.0f, (float)(client.id / 8 % 8) * 0.75f - 2.625f};
+        actor.nextPos = actor.body.position;
+        actor.speed = {0.0f, 0.0f, 0.0f};
+        world.wake(client.actor);
+        clientAt[addressKey(address)] = (int)clients.size();
+        clients.push_back(client);
+        sendWelcome(clients.back().address, clients.back().id);
+    }
+
+    void disconnect(int index) {
+        ServerClient& client = clients[index];
+        world.applyInput(client.actor, {0.0f, 0.0f, 0.0f});
+        freeActors.push_back(client.actor);
+        clientAt.erase(addressKey(client.address));
+        if (index != (int)clients.size() - 1) {
+            clients[index] = std::move(clients.back());
+            clientAt[addressKey(clients[index].address)] = index;
+        }
+        clients.pop_back();
+    }
+
+    // A server driven actor that walks around the ground plate. Returns its actor, -1 if the ids ran out.
+    int addNpc(const Vector3& position) {
+        if (world.actors.size() >= (size_t)SERVER_MAX_ENTITIES) return -1;
+        int actor = world.addActor(position, PLAYER_DIMENSIONS);
+        npcs.push_back(actor);
+        return actor;
+    }
+
+    // A third of the NPCs stand around, the rest pick a new direction now and then and turn back at the edge
+    void wander() {
+        float edge = groundSize * 0.5f - 2.0f;
+        for (size_t n = 0; n < npcs.size(); n++) {
+            if (n % 3 == 0) continue;
+            const Actor& actor = world.actors[npcs[n]];
+            const Vector3& p = actor.body.position;
+            if (fabsf(p.x) > edge || fabsf(p.z) > edge) {
+                world.applyInput(npcs[n], Vector3Normalize({-p.x, 0.0f, -p.z}) * NPC_WALK_SPEED);
+            } else if (npcRng() % 240 == 0 || (actor.move.x == 0.0f && actor.move.z == 0.0f)) {
+                float angle = (float)(npcRng() >> 8) / (float)(1u << 24) * 2.0f * PI;
+                world.applyInput(npcs[n], {cosf(angle) * NPC_WALK_SPEED, 0.0f, sinf(angle) * NPC_WALK_SPEED});
+            }
+        }
+    }
+
+    // Reads every waiting packet
+    void receive() {
+        uint8_t data[NET_MAX_PACKET];
+        NetAddress from;
+        int size;
+        while ((size = socket.receive(data, sizeof(data), from)) >= 0) {
+            packetsIn++;
+            bytesIn += size;
+            NetReader reader(data, size);
+            NetMessage type = reader.get<NetMessage>();
+            auto found = clientAt.find(addressKey(from));
+            if (type == NetMessage::Hello) {
+                uint16_t version = reader.get<uint16_t>();
+                if (reader.failed || version != NET_PROTOCOL_VERSION) continue;
+                // A repeated hello means our welcome got lost
+                if (found == clientAt.end()) connect(from);
+                else sendWelcome(from, clients[found->second].id);
+                continue;
+            }
+            if (type == NetMessage::Spectate) {
+                uint16_t version = reader.get<uint16_t>();
+                if (reader.failed || version != NET_PROTOCOL_VERSION || found != clientAt.end()) continue;
+                // Also the spectator's keep alive, the welcome goes out again in case it got lost
+                spectators.join(from, tickCount);
+                sendWelcome(from, 0);
+                continue;
+            }
+            if (found == clientAt.end()) {
+                if (type == NetMessage::Bye) spectators.leave(from);
+                continue;
+            }
+            ServerClient& client = clients[found->second];
+            client.lastHeard = tickCount;
+            if (type == NetMessage::Bye) {
+                disconnect(found->second);
+            } else if (type == NetMessage::Input) {
+                uint32_t ack = reader.get<uint32_t>();
+                if (ack > tickCount) ack = client.ackedSnapshot;   // Nothing we sent, don't rewind by it
+                if (ack > client.ackedSnapshot) client.ackedSnapshot = ack;
+                int count = reader.get<uint8_t>();
+                PlayerInput inputs[256];
+                for (int i = 0; i < count; i++) inputs[i] = ReadInput(reader);
+                if (reader.failed) continue;
+                // Newest first in the packet, queue the new ones oldest first
+                for (int i = count - 1; i >= 0; i--) {
+                    if (inputs[i].sequence <= client.lastQueued) continue;
+                    client.lastQueued = inputs[i].sequence;
+                    client.pending.push_back({inputs[i], ack});
+                }
+                if ((int)client.pending.size() > SERVER_MAX_PENDING_INPUTS) {
+                    client.pending.erase(client.pending.begin(), client.pending.end() - SERVER_MAX_PENDING_INPUTS);
+                }
+            }
+        }
+    }
+
+    // One fixed step: inputs, simulation, timeouts and, every SERVER_SEND_INTERVAL ticks, the state broadcast
+    void tick() {
+        tickCount++;
+        wander();
+        std::vector<uint8_t> jumping(clients.size(), 0), interacting(clients.size(), 0);
+        for (size_t i = 0; i < clients.size(); i++) {
+            ServerClient& client = clients[i];
+            // Without a new input keep moving the same way, a late packet shouldn't stop the player
+            if (!client.pending.empty()) {
+                client.current = client.pending.front().input;
+                client.viewTick = client.pending.front().viewTick;
+                client.pending.erase(client.pending.begin());
+                client.lastApplied = client.current.sequence;
+                jumping[i] = client.current.jump;
+                interacting[i] = client.current.interact;
+            }
+            Vector3 move = {client.current.moveX, 0.0f, client.current.moveZ};
+            // Don't trust the client with its speed. A little slack, the client normalizes in float too and any
+            // rescaling here would make its prediction miss.
+            float length = Vector3Length(move);
+            if (length > PLAYER_RUN_SPEED * 1.001f) move = move * (PLAYER_RUN_SPEED / length);
+            world.applyInput(client.actor, move);
+        }
+        world.step(SERVER_TICK_DT);
+        for (size_t i = 0; i < clients.size(); i++) {
+            Actor& actor = world.actors[clients[i].actor];
+            // As in SimulatePlayer(): the step decided whether the body rests, jump from there
+            if (jumping[i] && actor.body.isResting) {
+                actor.speed.y = PLAYER_JUMP_SPEED;
+                world.wake(clients[i].actor);
+            }
+            if (actor.body.position.y < PLAYER_RESPAWN_HEIGHT) {
+                actor.body.position = actor.nextPos = level.spawn;
+                actor.speed = {0.0f, 0.0f, 0.0f};
+            }
+        }
+        for (int npc : npcs) {
+            Actor& actor = world.actors[npc];
+            if (actor.body.position.y < PLAYER_RESPAWN_HEIGHT) {
+                actor.body.position = actor.nextPos = level.spawn;
+                actor.speed = {0.0f, 0.0f, 0.0f};
+            }
+        }
+        record();
+        for (size_t i = 0; i < clients.size(); i++) {
+            if (!interacting[i]) continue;
+            clients[i].talkingTo = interact(clients[i]);
+            sendTalk(clients[i]);
+        }
+        for (int i = (int)clients.size() - 1; i >= 0; i--) {
+            if (tickCount - clients[i].lastHeard > (uint32_t)SERVER_CLIENT_TIMEOUT) disconnect(i);
+        }
+        spectators.expire(tickCount, SERVER_SPECTATOR_TIMEOUT);
+        if (tickCount % SERVER_SEND_INTERVAL == 0) broadcast();
+    }
+
+    // Where everyone ended this tick, for lag compensated checks later
+    void record() {
+        lagCompensation.beginTick(tickCount);
+        for (const ServerClient& client : clients) {
+            const Actor& actor = world.actors[client.actor];
+            lagCompensation.add(client.actor, actor.body.position, actor.body.dimensions * 0.5f);
+        }
+        for (int npc : npcs) {
+            const Actor& actor = world.actors[npc];
+            lagCompensation.add(npc, actor.body.position, actor.body.dimensions * 0.5f);
+        }
+    }
+
+    // The entity an E press reaches: the nearest other one within SERVER_TALK_RANGE of the player, where the client
+    // saw it rather than where it is now, so a walking NPC counts where it was on the client's screen. The player
+    // itself is where it is now, its client predicts it. Returns its id, 0 if nobody is in reach.
+    uint16_t interact(const ServerClient& client) {
+        const Actor& actor = world.actors[client.actor];
+        Vector3 reach = actor.body.dimensions * 0.5f + Vector3{SERVER_TALK_RANGE, 0.0f, SERVER_TALK_RANGE};
+        rewound.clear();
+        lagCompensation.overlapBox((float)client.viewTick, {actor.body.position - reach, actor.body.position + reach}, rewound);
+        int nearest = -1;
+        float nearestDistance = INFINITY;
+        for (const RewindHit& hit : rewound) {
+            if (hit.handle == client.actor) continue;
+            BoundingBox box;
+            lagCompensation.boxAt(hit.handle, lagCompensation.clampTime((float)client.viewTick), box);
+            float distance = Vector3DistanceSqr((box.min + box.max) * 0.5f, actor.body.position);
+            if (distance < nearestDistance) {
+                nearestDistance = distance;
+                nearest = hit.handle;
+            }
+        }
+        if (nearest < 0) return 0;
+        interactions++;
+        return (uint16_t)(nearest + 1);
+    }
+
+    // Fills current with what this client should see. Candidates are the entities within interest.viewRadius, or
+    // interest.keepRadius for those it already has. Each builds up priority with nearness and with how far off the
+    // client's extrapolated copy has drifted; up to interest.maxUpdates of those past 1 are refreshed, the highest
+    // first. The rest go in exactly as the client will extrapolate them from its baseline, which costs nothing to
+    // encode. The client's own player is always refreshed, and anything it was sent but hasn't acknowledged yet is
+    // too, as leaving it out would remove it. So the work and the bytes depend on how crowded it is around the
+    // client, not on how many entities the world has.
+    void selectFor(ServerClient& client, const Snapshot* baseline, Snapshot& current) {
+        const Vector3 eye = world.actors[client.actor].body.position;
+        candidates.clear();
+        if (interest.enabled) grid.query(eye, interest.keepRadius, candidates, visitedBuckets);
+        else candidates.assign(entityActors.begin(), entityActors.end());
+        std::sort(candidates.begin(), candidates.end());     // Actor order is id order
+
+        uint32_t elapsed = baseline ? current.tick - baseline->tick : 0;
+        const size_t baseCount = baseline ? baseline->entities.size() : 0;
+        const float interval = (float)SERVER_SEND_INTERVAL / (float)SERVER_TICK_RATE;
+        size_t b = 0, v = 0;
+        considered.clear();
+        contenders.clear();
+        int budget = interest.enabled ? interest.maxUpdates : (int)candidates.size();
+        for (int actorIndex : candidates) {
+            const Actor& actor = world.actors[actorIndex];
+            uint16_t id = (uint16_t)(actorIndex + 1);
+            while (v < client.view.ids.size() && client.view.ids[v] < id) v++;
+            bool known = v < client.view.ids.size() && client.view.ids[v] == id;
+            bool shown = known && client.view.shown[v];
+            float dx = actor.body.position.x - eye.x, dz = actor.body.position.z - eye.z;
+            float distance = sqrtf(dx * dx + dz * dz);
+            if (interest.enabled && !shown && distance > interest.viewRadius) continue;
+            while (b < baseCount && baseline->entities[b].id < id) b++;
+
+            Candidate candidate;
+            candidate.fresh = Quantize({id, actor.body.position, actor.speed, (uint8_t)actor.body.isResting}, codec.settings);
+            candidate.base = b < baseCount && baseline->entities[b].id == id ? &baseline->entities[b] : nullptr;
+            float rate = 1.0f / (1.0f + distance * distance / (interest.nearDistance * interest.nearDistance));
+            candidate.priority = known ? client.view.priority[v] : 1.0f;
+            candidate.mustSend = !interest.enabled || actorIndex == client.actor || (shown && !candidate.base);
+            if (candidate.base) {
+                QuantizedEntity expected;
+                codec.extrapolate(*candidate.base, elapsed, expected);
+                float drift = 0.0f, speedDrift = 0.0f;
+                for (int axis = 0; axis < 3; axis++) {
+                    drift += fabsf((float)(candidate.fresh.position[axis] - expected.position[axis]));
+                    speedDrift += fabsf((float)(candidate.fresh.speed[axis] - expected.speed[axis]));
+                }
+                // Speed error counts as the distance it adds up to by the next snapshot
+                float error = drift / (float)codec.settings.positionScale + speedDrift / (float)codec.settings.speedScale * interval;
+                rate += interest.errorWeight * error;
+            }
+            candidate.priority += rate;
+            if (candidate.mustSend) budget--;
+            else if (candidate.priority >= 1.0f) contenders.push_back((int)considered.size());
+            considered.push_back(candidate);
+        }
+
+        // The most urgent of the rest, as many as the budget allows
+        if ((int)contenders.size() > std::max(budget, 0)) {
+            auto higher = [&](int a, int c) { return considered[a].priority > considered[c].priority; };
+            std::nth_element(contenders.begin(), contenders.begin() + std::max(budget, 0), contenders.end(), higher);
+            contenders.resize(std::max(budget, 0));
+        }
+        for (int index : contenders) considered[index].mustSend = true;
+
+        nextView.ids.clear();
+        nextView.priority.clear();
+        nextView.shown.clear();
+        for (const Candidate& candidate : considered) {
+            bool inSnapshot = candidate.mustSend || candidate.base;
+            if (candidate.mustSend) {
+                current.entities.push_back(candidate.fresh);
+                entitiesRefreshed++;
+            } else if (candidate.base) {
+                QuantizedEntity expected;
+                codec.extrapolate(*candidate.base, elapsed, expected);
+                current.entities.push_back(expected);
+            }
+            // A newcomer that didn't make it this time isn't shown yet, but keeps its priority for the next round
+            nextView.ids.push_back(candidate.fresh.id);
+            nextView.priority.push_back(candidate.mustSend ? 0.0f : candidate.priority);
+            nextView.shown.push_back(inSnapshot);
+        }
+        entitiesInView += (long long)current.entities.size();
+        std::swap(client.view, nextView);
+    }
+
+    // Every client gets a snapshot of its surroundings, encoded against what it has, split into NET_STATE_PIECE
+    // sized parts. Spectators get the whole world, encoded once for all of them.
+    void broadcast() {
+        if (clients.empty() && spectators.spectators.empty()) {
+            spectators.idle();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        entityActors.clear();
+        entityPositions.clear();
+        for (const ServerClient& client : clients) entityActors.push_back(client.actor);
+        for (int npc : npcs) entityActors.push_back(npc);
+        if (spectators.spectators.empty()) {
+            spectators.idle();
+        } else {
+            std::sort(entityActors.begin(), entityActors.end());    // Actor order is id order
+            Snapshot& everything = spectators.begin(tickCount);
+            for (int actorIndex : entityActors) {
+                const Actor& actor = world.actors[actorIndex];
+                everything.entities.push_back(Quantize({(uint16_t)(actorIndex + 1), actor.body.position, actor.speed,
+                    (uint8_t)actor.body.isResting}, codec.settings));
+            }
+            spectators.publish();
+            long long packetsBefore = spectators.packetsOut, bytesBefore = spectators.bytesOut;
+            spectators.fanOut(socket);
+            packetsOut += spectators.packetsOut - packetsBefore;
+            bytesOut += spectators.bytesOut - bytesBefore;
+        }
+        if (interest.enabled && !clients.empty()) {
+            for (int actor : entityActors) entityPositions.push_back(world.actors[actor].body.position);
+            grid.build(entityActors, entityPositions, interest.cellSize);
+        }
+
+        for (ServerClient& client : clients) {
+            // Start first: if the acknowledged snapshot sat in the slot being reused, it's gone
+            Snapshot& current = client.sent.start(tickCount);
+            const Snapshot* baseline = client.sent.find(client.ackedSnapshot);
+            selectFor(client, baseline, current);
+            int size = codec.encode(current, baseline, encoded.data(), (int)encoded.size());
+            if (size < 0) {
+                current.tick = 0;   // More than a snapshot can hold
+                continue;
+            }
+            int parts = std::max(1, (size + NET_STATE_PIECE - 1) / NET_STATE_PIECE);
+            for (int part = 0; part < parts; part++) {
+                int offset = part * NET_STATE_PIECE;
+                send(client.address, WriteStatePart(packet.data(), tickCount, baseline ? baseline->tick : 0u, client.lastApplied,
+                    part, parts, encoded.data() + offset, std::min(NET_STATE_PIECE, size - offset)));
+            }
+        }
+        replicationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
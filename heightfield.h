@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// How far a body may be pushed into a slope by walking and still get lifted on top of it. Anything steeper
+// than this per step blocks lateral movement like a wall.
+constexpr float TERRAIN_STEP_HEIGHT = 0.3f;
+
+// Terrain collider: a regular grid of heights over the XZ plane, bilinear in between. Vertex (ix, iz) sits at
+// (originX + ix * cellSize, heights[iz * (cellsX + 1) + ix], originZ + iz * cellSize).
+struct Heightfield {
+    float originX = 0.0f;
+    float originZ = 0.0f;
+    float cellSize = 1.0f;
+    int cellsX = 0;
+    int cellsZ = 0;
+    std::vector<float> heights;
+
+    Heightfield() = default;
+    Heightfield(float originX, float originZ, float cellSize, int cellsX, int cellsZ)
+        : originX(originX), originZ(originZ), cellSize(cellSize), cellsX(cellsX), cellsZ(cellsZ),
+          heights((size_t)(cellsX + 1) * (size_t)(cellsZ + 1), 0.0f) {}
+
+    float& at(int ix, int iz) { return heights[(size_t)iz * (size_t)(cellsX + 1) + (size_t)ix]; }
+    float at(int ix, int iz) const { return heights[(size_t)iz * (size_t)(cellsX + 1) + (size_t)ix]; }
+
+    float endX() const { return originX + (float)cellsX * cellSize; }
+    float endZ() const { return originZ + (float)cellsZ * cellSize; }
+
+    // Surface height at a point, the point has to be inside the terrain
+    float sample(float x, float z) const {
+        float fx = (x - originX) / cellSize;
+        float fz = (z - originZ) / cellSize;
+        int ix = std::clamp((int)floorf(fx), 0, cellsX - 1);
+        int iz = std::clamp((int)floorf(fz), 0, cellsZ - 1);
+        float tx = std::clamp(fx - (float)ix, 0.0f, 1.0f);
+        float tz = std::clamp(fz - (float)iz, 0.0f, 1.0f);
+        float h0 = at(ix, iz) + (at(ix + 1, iz) - at(ix, iz)) * tx;
+        float h1 = at(ix, iz + 1) + (at(ix + 1, iz + 1) - at(ix, iz + 1)) * tx;
+        return h0 + (h1 - h0) * tz;
+    }
+
+    // Highest surface point under a footprint rectangle, -INFINITY if it doesn't touch the terrain.
+    // Bilinear patches peak at the corners of whatever part of them is covered, so it's enough to sample where the
+    // footprint's edges and the grid lines cross. For a given footprint size that is a fixed number of lookups,
+    // however large the terrain is.
+    float maxHeight(float minX, float maxX, float minZ, float maxZ) const {
+        if (maxX <= originX || minX >= endX() || maxZ <= originZ || minZ >= endZ()) return -INFINITY;
+        minX = std::max(minX, originX);
+        maxX = std::min(maxX, endX());
+        minZ = std::max(minZ, originZ);
+        maxZ = std::min(maxZ, endZ());
+
+        int firstX = (int)ceilf((minX - originX) / cellSize);
+        int lastX = (int)floorf((maxX - originX) / cellSize);
+        int firstZ = (int)ceilf((minZ - originZ) / cellSize);
+        int lastZ = (int)floorf((maxZ - originZ) / cellSize);
+
+        float best = -INFINITY;
+        for (int j = firstZ - 1; j <= lastZ + 1; j++) {
+            float z = j < firstZ ? minZ : j > lastZ ? maxZ : originZ + (float)j * cellSize;
+            for (int i = firstX - 1; i <= lastX + 1; i++) {
+                float x = i < firstX ? minX : i > lastX ? maxX : originX + (float)i * cellSize;
+                best = std::max(best, sample(x, z));
+            }
+        }
+        return best;
+    }
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <raylib.h>
+#include <rlgl.h>
+#include <string>
+#include <vector>
+
+// One laid out string: the glyph quads relative to its top left corner, ready to be offset and submitted
+struct HudText {
+    std::string text;
+    int fontSize = 0;
+    int width = 0;              // Same as MeasureText(text, fontSize)
+    // 4 vertices per glyph, x y u v each
+    std::vector<float> vertices;
+};
+
+// Screen space text layer. Call sites own a slot each, the slot keeps the laid out glyphs of its string
+// and only lays them out again when the string or size changes. Everything queued during a frame is
+// submitted as one textured quad batch in flush(), instead of one DrawText call per string.
+// Uses raylib's default font with the same metrics as DrawText/MeasureText.
+struct Hud {
+    struct Queued {
+        int slot;
+        float x, y;
+        Color color;
+    };
+
+    std::vector<HudText> slots;
+    std::vector<Queued> queue;
+
+    // Lays out text into slot (if it isn't already) and returns its width in pixels
+    int layout(int slot, const char* text, int fontSize) {
+        if (slot >= (int)slots.size()) slots.resize(slot + 1);
+        HudText& line = slots[slot];
+        if (line.fontSize == fontSize && line.text == text) return line.width;
+
+        line.text = text;
+        line.fontSize = fontSize;
+        line.vertices.clear();
+
+        // Same rules as DrawText: minimum size 10, spacing a tenth of the size, 2 px between lines
+        Font font = GetFontDefault();
+        if (fontSize < font.baseSize) fontSize = font.baseSize;
+        const float spacing = (float)(fontSize / font.baseSize);
+        const float scale = (float)fontSize / (float)font.baseSize;
+        const float padding = (float)font.glyphPadding;
+        const float texWidth = (float)font.texture.width;
+        const float texHeight = (float)font.texture.height;
+
+        float offsetX = 0.0f;
+        float offsetY = 0.0f;
+        // Width bookkeeping mirrors MeasureTextEx
+        float lineWidth = 0.0f;
+        float maxWidth = 0.0f;
+        int lineBytes = 0;
+        int maxLineBytes = 0;
+
+        const int length = (int)line.text.size();
+        for (int i = 0; i < length;) {
+            int codepointSize = 0;
+            int codepoint = GetCodepointNext(&line.text[i], &codepointSize);
+            int index = GetGlyphIndex(font, codepoint);
+            i += codepointSize;
+
+            if (codepoint == '\n') {
+                offsetY += (float)fontSize + 2.0f;
+                offsetX = 0.0f;
+                if (lineWidth > maxWidth) maxWidth = lineWidth;
+                if (lineBytes > maxLineBytes) maxLineBytes = lineBytes;
+                lineWidth = 0.0f;
+                lineBytes = 0;
+                continue;
+            }
+
+            const Rectangle rec = font.recs[index];
+            const GlyphInfo& glyph = font.glyphs[index];
+            if (codepoint != ' ' && codepoint != '\t') {
+                const float x0 = offsetX + ((float)glyph.offsetX - padding) * scale;
+                const float y0 = offsetY + ((float)glyph.offsetY - padding) * scale;
+                const float x1 = x0 + (rec.width + 2.0f * padding) * scale;
+                const float y1 = y0 + (rec.height + 2.0f * padding) * scale;
+                const float u0 = (rec.x - padding) / texWidth;
+                const float v0 = (rec.y - padding) / texHeight;
+                const float u1 = (rec.x + rec.width + padding) / texWidth;
+                const float v1 = (rec.y + rec.height + padding) / texHeight;
+                // Top left, bottom left, bottom right, top right like DrawTexturePro
+                line.vertices.insert(line.vertices.end(), {
+                    x0, y0, u0, v0,
+                    x0, y1, u0, v1,
+                    x1, y1, u1, v1,
+                    x1, y0, u1, v0,
+                });
+            }
+
+            const float advance = glyph.advanceX == 0 ? rec.width : (float)glyph.advanceX;
+            offsetX += advance * scale + spacing;
+            lineWidth += glyph.advanceX == 0 ? rec.width + (float)glyph.offsetX : (float)glyph.advanceX;
+            lineBytes++;
+        }
+        if (lineWidth > maxWidth) maxWidth = lineWidth;
+        if (lineBytes > maxLineBytes) maxLineBytes = lineBytes;
+        line.width = (int)(maxWidth * scale + (float)(maxLineBytes - 1) * spacing);
+        return line.width;
+    }
+
+    // Queues a slot that was laid out with layout() this frame or earlier
+    void draw(int slot, int x, int y, Color color) {
+        queue.push_back({slot, (float)x, (float)y, color});
+    }
+
+    // Lay out and queue in one go, for strings that don't need measuring first
+    void text(int slot, const char* text, int x, int y, int fontSize, Color color) {
+        layout(slot, text, fontSize);
+        draw(slot, x, y, color);
+    }
+
+    // Submits everything queued since the last flush as a single batch. Call between BeginDrawing/EndDrawing,
+    // outside of 3D mode.
+    void flush() {
+        if (queue.empty()) return;
+        int vertexCount = 0;
+        for (const Queued& queued : queue) vertexCount += (int)slots[queued.slot].vertices.size() / 4;
+
+        rlCheckRenderBatchLimit(vertexCount);
+        rlSetTexture(GetFontDefault().texture.id);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (const Queued& queued : queue) {
+            const std::vector<float>& vertices = slots[queued.slot].vertices;
+            rlColor4ub(queued.color.r, queued.color.g, queued.color.b, queued.color.a);
+            for (size_t v = 0; v < vertices.size(); v += 4) {
+                rlTexCoord2f(vertices[v + 2], vertices[v + 3]);
+                rlVertex2f(queued.x + vertices[v], queued.y + vertices[v + 1]);
+            }
+        }
+        rlEnd();
+        rlSetTexture(0);
+        queue.clear();
+    }
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <raylib.h>
+
+// For screens that sit still until the user does something (game over, menus). The contents are rendered
+// once into a texture and that texture is re-presented every frame, only re-rendering when invalidate()
+// is called. While active, raylib's event waiting is on, so EndDrawing() sleeps until there is input
+// instead of spinning at the target FPS.
+struct IdleScreen {
+    RenderTexture2D frame = {0};
+    bool active = false;
+    bool dirty = true;
+
+    void enter() {
+        if (active) return;
+        active = true;
+        dirty = true;
+        EnableEventWaiting();
+    }
+
+    void leave() {
+        if (!active) return;
+        active = false;
+        DisableEventWaiting();
+    }
+
+    void invalidate() { dirty = true; }
+
+    // Returns true when the cached frame needs to be rendered again. If so, draw the screen contents
+    // and call endRedraw().
+    bool beginRedraw() {
+        if (frame.id == 0 || frame.texture.width != GetScreenWidth() || frame.texture.height != GetScreenHeight()) {
+            if (frame.id != 0) UnloadRenderTexture(frame);
+            frame = LoadRenderTexture(GetScreenWidth(), GetScreenHeight());
+            dirty = true;
+        }
+        if (!dirty) return false;
+        BeginTextureMode(frame);
+        return true;
+    }
+
+    void endRedraw() {
+        EndTextureMode();
+        dirty = false;
+    }
+
+    void present() const {
+        BeginDrawing();
+        // Render textures are upside down, hence the negative height
+        DrawTextureRec(frame.texture,
+            {0.0f, 0.0f, (float)frame.texture.width, -(float)frame.texture.height},
+            {0.0f, 0.0f},
+            WHITE);
+        EndDrawing();
+    }
+
+    void unload() {
+        if (frame.id != 0) UnloadRenderTexture(frame);
+        frame = {0};
+    }
+};
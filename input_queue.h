@@ -0,0 +1,86 @@
+#pragma once
+
+#include <raylib.h>
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+constexpr int MAX_INPUT_KEYS = 512;
+
+// A key going down or up, stamped with the time it was seen (FramePacer::nowNs() clock)
+struct InputEvent {
+    long long timeNs;
+    int key;
+    bool down;
+};
+
+// Which keys are currently held, as seen by the simulation after applying events in order
+struct KeyState {
+    bool down[MAX_INPUT_KEYS] = {};
+
+    void apply(const InputEvent& event) {
+        if (event.key >= 0 && event.key < MAX_INPUT_KEYS) down[event.key] = event.down;
+    }
+
+    bool isDown(int key) const { return down[key]; }
+};
+
+// Timestamped input events waiting for the simulation. Anything can push (a polling thread, a platform
+// callback), the simulation drains everything up to the time of the tick it is about to run, so an input
+// is applied on the first tick after it happened rather than on the next rendered frame.
+struct InputQueue {
+    std::mutex mutex;
+    std::vector<InputEvent> events;
+    // Keys sample() watches, and what it saw on the previous call
+    std::vector<int> watched;
+    bool seenDown[MAX_INPUT_KEYS] = {};
+
+    explicit InputQueue(std::vector<int> keys) : watched(std::move(keys)) {}
+
+    void push(const InputEvent& event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Pushers usually arrive in time order, keep the queue sorted if they don't
+        auto at = std::upper_bound(events.begin(), events.end(), event.timeNs,
+            [](long long t, const InputEvent& e) { return t < e.timeNs; });
+        events.insert(at, event);
+    }
+
+    // Turns raylib's key state into events. raylib only updates input in PollInputEvents() (also called by
+    // EndDrawing()), and every poll forgets the previous one's presses, so call this on the main thread between any
+    // two polls: after EndDrawing() and before each PollInputEvents() of your own. IsKeyDown() alone misses a tap that
+    // went down and up between two polls, so the presses of the poll are drained from GetKeyPressed() too, which
+    // keeps them after the release; such a tap is queued as both events. This takes GetKeyPressed() away from
+    // everyone else.
+    void sample(long long now) {
+        bool pressed[MAX_INPUT_KEYS] = {};
+        for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed()) {
+            if (key > 0 && key < MAX_INPUT_KEYS) pressed[key] = true;
+        }
+        for (int key : watched) {
+            bool down = IsKeyDown(key);
+            bool was = seenDown[key];
+            if (pressed[key]) {
+                if (was) push({now, key, false});   // Let go and pressed again since the last poll
+                push({now, key, true});
+                was = true;
+            }
+            if (down != was) push({now, key, down});
+            seenDown[key] = down;
+        }
+    }
+
+    // Moves every event up to and including time until into out, oldest first
+    void drain(long long until, std::vector<InputEvent>& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto end = std::upper_bound(events.begin(), events.end(), until,
+            [](long long t, const InputEvent& e) { return t < e.timeNs; });
+        out.insert(out.end(), events.begin(), end);
+        events.erase(events.begin(), end);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.clear();
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <raylib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct InterestSettings {
+    bool enabled = true;        // Off: everything goes to everyone, every snapshot
+    float cellSize = 8.0f;
+    float viewRadius = 24.0f;   // The isometric camera shows about 15 units around the player, plus a margin
+    float keepRadius = 28.0f;   // Already visible entities stay until they're this far, so the edge doesn't flicker
+    int maxUpdates = 64;        // Entities refreshed per snapshot per client
+    // An entity's priority grows every snapshot by 1 / (1 + (distance / nearDistance)^2), plus errorWeight per unit
+    // the client's extrapolated copy is off by. It's sent once it reaches 1, the highest first, and starts over.
+    float nearDistance = 8.0f;
+    float errorWeight = 4.0f;
+};
+
+// Uniform grid over the replicated entities, rebuilt for every broadcast with a counting sort: count per bucket,
+// prefix sum, scatter. Cells hash into a power of two bucket count, so the world needs no bounds.
+struct InterestGrid {
+    float cellSize = 8.0f;
+    std::vector<int> bucketStart;
+    std::vector<int> bucketOf;
+    std::vector<int> sorted;            // Entity handles in bucket order
+    std::vector<Vector3> sortedPos;
+
+    int cellCoord(float v) const { return (int)floorf(v / cellSize); }
+
+    int bucket(int cx, int cz) const {
+        unsigned h = (unsigned)cx * 73856093u ^ (unsigned)cz * 19349663u;
+        return (int)(h & (unsigned)(bucketStart.size() - 2));
+    }
+
+    // handles[i] is what query() reports for the entity at positions[i]
+    void build(const std::vector<int>& handles, const std::vector<Vector3>& positions, float size) {
+        cellSize = size;
+        int count = (int)handles.size();
+        int buckets = 64;
+        while (buckets < count) buckets *= 2;
+        bucketStart.assign(buckets + 1, 0);
+        bucketOf.resize(count);
+        sorted.resize(count);
+        sortedPos.resize(count);
+        for (int i = 0; i < count; i++) {
+            bucketOf[i] = bucket(cellCoord(positions[i].x), cellCoord(positions[i].z));
+            bucketStart[bucketOf[i] + 1]++;
+        }
+        for (int b = 0; b < buckets; b++) bucketStart[b + 1] += bucketStart[b];
+        for (int i = 0; i < count; i++) {
+            int slot = bucketStart[bucketOf[i]]++;
+            sorted[slot] = handles[i];
+            sortedPos[slot] = positions[i];
+        }
+        for (int b = buckets; b > 0; b--) bucketStart[b] = bucketStart[b - 1];
+        bucketStart[0] = 0;
+    }
+
+    // Appends the handles within radius of center on XZ. visited is scratch for buckets already looked at.
+    void query(const Vector3& center, float radius, std::vector<int>& out, std::vector<int>& visited) const {
+        if (sorted.empty()) return;
+        visited.clear();
+        float r2 = radius * radius;
+        int x0 = cellCoord(center.x - radius), x1 = cellCoord(center.x + radius);
+        int z0 = cellCoord(center.z - radius), z1 = cellCoord(center.z + radius);
+        for (int cz = z0; cz <= z1; cz++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                int b = bucket(cx, cz);
+                if (std::find(visited.begin(), visited.end(), b) != visited.end()) continue;
+                visited.push_back(b);
+                for (int slot = bucketStart[b]; slot < bucketStart[b + 1]; slot++) {
+                    float dx = sortedPos[slot].x - center.x, dz = sortedPos[slot].z - center.z;
+                    if (dx * dx + dz * dz <= r2) out.push_back(sorted[slot]);
+                }
+            }
+        }
+    }
+};
+
+// The entities around one client, sorted by id: the priority each has built up, and whether the client has it yet
+// (a newcomer can wait a few snapshots for a slot)
+struct ClientInterest {
+    std::vector<uint16_t> ids;
+    std::vector<float> priority;
+    std::vector<uint8_t> shown;
+};
@@ -0,0 +1,120 @@
+// Benchmark for interest management
+//
+// Runs a GameServer with wandering NPCs and a group of bot clients over loopback, like net_loadtest, for growing
+// world populations at the same density: the level grows with the population, so every client has about as many
+// entities around it each time. With interest management the replication cost per client and the bytes sent should
+// stay about flat while the world grows; without it both grow with the population (until the snapshot no longer
+// fits). Ticks run back to back. Reports the time spent building and sending snapshots, apart from the simulation,
+// and what the clients receive. Headless.
+// Options:
+//     --populations A,B,C   NPC counts to test (default 1000,4000,16000)
+//     --clients N           bot clients (default 32)
+//     --ticks N             ticks per run (default 600)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "game_server.h"
+#include "game_client.h"
+#include "frame_pacer.h"
+
+constexpr float AREA_PER_NPC = 36.0f;   // One NPC per 6 x 6 units
+
+int main(int argc, char** argv) {
+    std::vector<int> populations = {1000, 4000, 16000};
+    int count = 32;
+    int ticks = 600;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--populations") == 0) {
+            populations.clear();
+            for (char* p = argv[i + 1]; *p; ) {
+                populations.push_back(std::clamp((int)strtol(p, &p, 10), 1, SERVER_MAX_ENTITIES - 1024));
+                if (*p == ',') p++;
+                else break;
+            }
+        } else if (strcmp(argv[i], "--clients") == 0) {
+            count = std::clamp(atoi(argv[i + 1]), 1, 1000);
+        } else if (strcmp(argv[i], "--ticks") == 0) {
+            ticks = std::max(1, atoi(argv[i + 1]));
+        }
+    }
+
+    printf("%d clients, %d ticks per run, one NPC per %.0f square units\n", count, ticks, AREA_PER_NPC);
+    for (int population : populations) {
+        for (bool interest : {true, false}) {
+            float size = ceilf(sqrtf((float)population * AREA_PER_NPC));
+            GameServer server(1234, size);
+            server.interest.enabled = interest;
+            std::mt19937 rng(population);
+            std::uniform_real_distribution<float> spread(-size * 0.5f + 2.0f, size * 0.5f - 2.0f);
+            for (int i = 0; i < population; i++) server.addNpc({spread(rng), 1.0f, spread(rng)});
+            if (!server.listen(0, true)) {
+                fprintf(stderr, "Can't open the server socket\n");
+                return 1;
+            }
+            NetAddress address = {0x7f000001u, server.socket.localPort()};
+            std::vector<std::unique_ptr<GameClient>> bots;
+            for (int i = 0; i < count; i++) {
+                bots.push_back(std::make_unique<GameClient>());
+                if (!bots.back()->open(address, true)) {
+                    fprintf(stderr, "Can't open client socket %d\n", i);
+                    return 1;
+                }
+                bots.back()->sendHello();
+            }
+            for (int attempt = 0; attempt < 100 && (int)server.clients.size() < count; attempt++) {
+                server.receive();
+                FramePacer::sleepUntilNs(FramePacer::nowNs() + 1'000'000);
+            }
+            for (auto& bot : bots) bot->poll();
+
+            std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+            std::vector<float> heading(count);
+            for (float& h : heading) h = angle(rng);
+            long long bytesBefore = server.bytesOut;
+            double busyMs = 0.0;
+            for (int tick = 0; tick < ticks; tick++) {
+                for (int i = 0; i < count; i++) {
+                    // Run around, heading back to the middle when getting near the edge
+                    if (rng() % 120 == 0) heading[i] = angle(rng);
+                    if (const EntityState* self = bots[i]->self()) {
+                        if (fabsf(self->position.x) > size * 0.4f || fabsf(self->position.z) > size * 0.4f) {
+                            heading[i] = atan2f(-self->position.z, -self->position.x);
+                        }
+                    }
+                    bots[i]->sendInput(cosf(heading[i]) * PLAYER_RUN_SPEED, sinf(heading[i]) * PLAYER_RUN_SPEED, false);
+                }
+                long long start = FramePacer::nowNs();
+                server.receive();
+                server.tick();
+                busyMs += (double)(FramePacer::nowNs() - start) / 1e6;
+                for (auto& bot : bots) bot->poll();
+            }
+
+            long long snapshots = 0, undecodable = 0, seen = 0;
+            for (auto& bot : bots) {
+                snapshots += bot->snapshots;
+                undecodable += bot->undecodable;
+                seen += (long long)bot->players.size();
+            }
+            double seconds = (double)ticks / SERVER_TICK_RATE;
+            double broadcasts = (double)(ticks / SERVER_SEND_INTERVAL) * count;
+            printf("%6d NPCs on %4.0f x %-4.0f interest %-3s: tick %6.3f ms, replication %.4f ms per client snapshot, "
+                   "%7.1f kB/s per client, %6.1f entities in view, %5.1f refreshed per snapshot, %lld decoded, %lld undecodable, "
+                   "%.0f shown per client at the end\n",
+                population, size, size, interest ? "on" : "off", busyMs / ticks, server.replicationMs / broadcasts,
+                (double)(server.bytesOut - bytesBefore) / seconds / 1000.0 / count, (double)server.entitiesInView / broadcasts,
+                (double)server.entitiesRefreshed / broadcasts, snapshots, undecodable, (double)seen / count);
+            for (auto& bot : bots) bot->disconnect();
+        }
+    }
+    return 0;
+}
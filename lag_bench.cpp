@@ -0,0 +1,140 @@
+// Benchmark for lag compensated rewind queries
+//
+// Records a wandering crowd into LagCompensation every tick, the way GameServer does, and fires a batch of rewind
+// queries per tick at random view times up to LAG_MAX_REWIND_TICKS back: half "Press E" style box overlaps around
+// an entity, half hit scan rays from one. Reports what recording and the queries cost, how many candidates each
+// query had to test, and checks a sample of the answers against testing every entity. Headless.
+// Options:
+//     --entities N      crowd size (default 4000)
+//     --queries N       rewind queries per tick (default 500)
+//     --seconds N       simulated time (default 10)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "world.h"
+#include "lag_compensation.h"
+
+constexpr int TICK_RATE = 120;
+constexpr float TICK_DT = 1.0f / (float)TICK_RATE;
+constexpr int CHECK_EVERY = 16;     // Queries between brute force checks
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int count = 4000;
+    int queriesPerTick = 500;
+    double seconds = 10.0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--entities") == 0) count = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--queries") == 0) queriesPerTick = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--seconds") == 0) seconds = std::max(1.0, atof(argv[i + 1]));
+    }
+
+    // A plate sized for one entity per 36 square units, everyone walking and turning now and then
+    float half = sqrtf((float)count * 36.0f) * 0.5f;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> spread(-half + 2.0f, half - 2.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Collider> colliders = {Collider({0.0f, 0.475f, 0.0f}, {half * 2.0f, 0.05f, half * 2.0f})};
+    Player player({0.0f, -1000.0f, 0.0f}, {0.5f, 1.0f, 0.5f});
+    World world(colliders, player);
+    for (int i = 0; i < count; i++) world.addActor({spread(rng), 1.0f, spread(rng)}, {0.5f, 1.0f, 0.5f});
+
+    LagCompensation lag;
+    std::vector<RewindHit> hits, expected;
+    const int ticks = (int)(seconds * TICK_RATE);
+    double recordMs = 0.0, overlapMs = 0.0, rayMs = 0.0;
+    long long overlaps = 0, rays = 0, overlapHits = 0, rayHits = 0, checked = 0, mismatches = 0;
+    for (int tick = 1; tick <= ticks; tick++) {
+        for (int i = 0; i < count; i++) {
+            if (tick == 1 || rng() % 240 == 0) {
+                float a = angle(rng);
+                world.applyInput(i, {cosf(a) * 4.0f, 0.0f, sinf(a) * 4.0f});
+            }
+            const Vector3& p = world.actors[i].body.position;
+            if (fabsf(p.x) > half - 3.0f || fabsf(p.z) > half - 3.0f) world.applyInput(i, {-p.x * 0.1f, 0.0f, -p.z * 0.1f});
+        }
+        world.step(TICK_DT);
+
+        auto start = std::chrono::steady_clock::now();
+        lag.beginTick((uint32_t)tick);
+        for (int i = 0; i < count; i++) lag.add(i, world.actors[i].body.position, world.actors[i].body.dimensions * 0.5f);
+        recordMs += MsSince(start);
+        if (tick <= LAG_MAX_REWIND_TICKS) continue;     // Let the history fill up first
+
+        for (int q = 0; q < queriesPerTick; q++) {
+            // Asked by the client playing entity shooter, looking at the world as it was up to half a second ago
+            int shooter = (int)(rng() % (unsigned)count);
+            float time = lag.clampTime((float)tick - unit(rng) * (float)LAG_MAX_REWIND_TICKS);
+            const Vector3 eye = world.actors[shooter].body.position;
+            bool check = q % CHECK_EVERY == 0;
+            if (q % 2 == 0) {
+                Vector3 reach = {2.0f, 0.5f, 2.0f};
+                BoundingBox area = {eye - reach, eye + reach};
+                hits.clear();
+                auto queryStart = std::chrono::steady_clock::now();
+                lag.overlapBox(time, area, hits);
+                overlapMs += MsSince(queryStart);
+                overlaps++;
+                overlapHits += (long long)hits.size();
+                if (!check) continue;
+                expected.clear();
+                for (int i = 0; i < count; i++) {
+                    BoundingBox box;
+                    if (lag.boxAt(i, time, box) && LagCompensation::overlaps(box, area)) expected.push_back({i, 0.0f});
+                }
+                auto byHandle = [](const RewindHit& a, const RewindHit& b) { return a.handle < b.handle; };
+                std::sort(hits.begin(), hits.end(), byHandle);
+                checked++;
+                bool same = hits.size() == expected.size();
+                for (size_t h = 0; same && h < hits.size(); h++) same = hits[h].handle == expected[h].handle;
+                mismatches += !same;
+            } else {
+                float a = angle(rng);
+                Vector3 direction = {cosf(a), 0.0f, sinf(a)};
+                auto queryStart = std::chrono::steady_clock::now();
+                RewindHit hit = lag.raycast(time, eye, direction, 40.0f, shooter);
+                rayMs += MsSince(queryStart);
+                rays++;
+                rayHits += hit.handle >= 0;
+                if (!check) continue;
+                RewindHit nearest = {-1, 40.0f};
+                const Vector3 invDir = SceneQuery::inverse(direction);
+                int axis;
+                for (int i = 0; i < count; i++) {
+                    BoundingBox box;
+                    if (i == shooter || !lag.boxAt(i, time, box)) continue;
+                    float distance = SceneQuery::slab(eye, invDir, box.min, box.max, {0.0f, 0.0f, 0.0f}, nearest.distance, axis);
+                    if (distance >= 0.0f) nearest = {i, distance};
+                }
+                checked++;
+                // Ties at the same distance can go either way
+                mismatches += !(hit.handle == nearest.handle || (hit.handle >= 0 && nearest.handle >= 0 && hit.distance == nearest.distance));
+            }
+        }
+    }
+
+    int queryTicks = ticks - LAG_MAX_REWIND_TICKS;
+    printf("%d entities, %d ticks, %d rewind queries per tick\n", count, ticks, queriesPerTick);
+    printf("record:  %.3f ms per tick\n", recordMs / ticks);
+    printf("overlap: %.2f us per query, %.2f hits, %lld queries\n", overlapMs * 1000.0 / (double)overlaps,
+        (double)overlapHits / (double)overlaps, overlaps);
+    printf("ray:     %.2f us per query, %.1f%% hit, %lld queries\n", rayMs * 1000.0 / (double)rays,
+        100.0 * (double)rayHits / (double)rays, rays);
+    printf("queries: %.3f ms per tick (block indexing included), %.1f candidates tested per query\n",
+        (overlapMs + rayMs) / queryTicks, (double)lag.tested / (double)lag.queries);
+    printf("checked %lld against brute force, %lld mismatches\n", checked, mismatches);
+    return 0;
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "scene_query.h"
+
+constexpr int LAG_HISTORY_TICKS = 64;       // Ticks of positions kept, a power of two. About half a second at 120 Hz.
+constexpr int LAG_MAX_REWIND_TICKS = 60;    // Older view times are clamped, nobody gets to shoot that far into the past
+constexpr int LAG_BLOCK_TICKS = 8;          // History is indexed in blocks of this many ticks
+constexpr float LAG_CELL_SIZE = 4.0f;
+
+struct RewindHit {
+    int handle = -1;
+    float distance = 0.0f;  // Along the ray, for raycast()
+};
+
+// Server side lag compensation. Clients see the other entities as they were a round trip ago, so checks for what a
+// client hit or stood next to have to run against the world at its view time, not the present. Every tick the
+// server records where each entity is into a ring of frames. For queries the history is cut into blocks of
+// LAG_BLOCK_TICKS ticks, and each block keeps the box every entity swept during it, bucketed into a hashed XZ grid.
+// A rewind query only looks at the grid cells it touches in the block around the asked time, and tests the
+// candidates at their position interpolated to that time. Each block's grid is built the first time it's queried
+// after a change, so a sealed block is sorted once and the open one at most once per tick.
+//
+// Entities are small dense handles (the server uses actor indices). Times are in ticks, fractions interpolate.
+struct LagCompensation {
+    struct Frame {
+        uint32_t tick = 0;              // 0: empty
+        std::vector<Vector3> position;  // By handle
+        std::vector<Vector3> half;
+        std::vector<uint8_t> present;
+    };
+    struct Block {
+        uint32_t first = 0;             // Covers ticks first to first + LAG_BLOCK_TICKS, the last shared with the next
+        bool indexed = false;
+        std::vector<BoundingBox> bounds;    // Swept over the block, by handle
+        std::vector<uint8_t> present;
+        std::vector<int> members;
+        BoundingBox extent;             // Of every member's swept bounds
+        // Hashed XZ grid: entries of bucket b are entries[bucketStart[b]] up to bucketStart[b + 1]
+        std::vector<int> bucketStart;
+        std::vector<int> entries;
+    };
+    Frame frames[LAG_HISTORY_TICKS];
+    Block blocks[LAG_HISTORY_TICKS / LAG_BLOCK_TICKS + 2];
+    uint32_t newest = 0;
+    Frame* recording = nullptr;
+    // Candidates already tested by the current query
+    std::vector<uint32_t> stamp;
+    uint32_t queryStamp = 0;
+    // Statistics
+    long long queries = 0, tested = 0;
+
+    static constexpr int BLOCK_COUNT = LAG_HISTORY_TICKS / LAG_BLOCK_TICKS + 2;
+
+    // Starts recording the positions at the end of tick, ticks counting up from 1
+    void beginTick(uint32_t tick) {
+        newest = tick;
+        recording = &frames[tick % LAG_HISTORY_TICKS];
+        recording->tick = tick;
+        std::fill(recording->present.begin(), recording->present.end(), 0);
+    }
+
+    void add(int handle, const Vector3& position, const Vector3& halfExtents) {
+        Frame& frame = *recording;
+        if (handle >= (int)frame.present.size()) {
+            frame.position.resize(handle + 1);
+            frame.half.resize(handle + 1);
+            frame.present.resize(handle + 1, 0);
+        }
+        frame.position[handle] = position;
+        frame.half[handle] = halfExtents;
+        frame.present[handle] = 1;
+        BoundingBox box = {position - halfExtents, position + halfExtents};
+        touch(blockFor(frame.tick), handle, box);
+        // The first tick of a block also closes the previous one, so interpolating across the seam stays in one block
+        if (frame.tick % LAG_BLOCK_TICKS == 0 && frame.tick > LAG_BLOCK_TICKS) touch(blockFor(frame.tick - 1), handle, box);
+    }
+
+    Block& blockFor(uint32_t tick) {
+        uint32_t first = tick - tick % LAG_BLOCK_TICKS;
+        Block& block = blocks[(first / LAG_BLOCK_TICKS) % BLOCK_COUNT];
+        if (block.first != first) {
+            for (int member : block.members) block.present[member] = 0;
+            block.members.clear();
+            block.first = first;
+            block.indexed = false;
+        }
+        return block;
+    }
+
+    static void touch(Block& block, int handle, const BoundingBox& box) {
+        if (handle >= (int)block.present.size()) {
+            block.bounds.resize(handle + 1);
+            block.present.resize(handle + 1, 0);
+        }
+        if (!block.present[handle]) {
+            block.present[handle] = 1;
+            block.bounds[handle] = box;
+            block.members.push_back(handle);
+        } else {
+            block.bounds[handle].min = Vector3Min(block.bounds[handle].min, box.min);
+            block.bounds[handle].max = Vector3Max(block.bounds[handle].max, box.max);
+        }
+        block.indexed = false;
+    }
+
+    static int cellCoord(float v) { return (int)floorf(v / LAG_CELL_SIZE); }
+
+    static int bucket(const Block& block, int cx, int cz) {
+        unsigned h = (unsigned)cx * 73856093u ^ (unsigned)cz * 19349663u;
+        return (int)(h & (unsigned)(block.bucketStart.size() - 2));
+    }
+
+    // Counting sort of the members into every cell their swept box overlaps
+    static void index(Block& block) {
+        int buckets = 64;
+        while (buckets < (int)block.members.size() * 2) buckets *= 2;
+        block.bucketStart.assign(buckets + 1, 0);
+        auto forCells = [&](int member, auto&& visit) {
+            const BoundingBox& box = block.bounds[member];
+            for (int cz = cellCoord(box.min.z); cz <= cellCoord(box.max.z); cz++) {
+                for (int cx = cellCoord(box.min.x); cx <= cellCoord(box.max.x); cx++) visit(bucket(block, cx, cz));
+            }
+        };
+        block.extent = {{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+        for (int member : block.members) {
+            block.extent.min = Vector3Min(block.extent.min, block.bounds[member].min);
+            block.extent.max = Vector3Max(block.extent.max, block.bounds[member].max);
+            forCells(member, [&](int b) { block.bucketStart[b + 1]++; });
+        }
+        for (int b = 0; b < buckets; b++) block.bucketStart[b + 1] += block.bucketStart[b];
+        block.entries.resize(block.bucketStart[buckets]);
+        for (int member : block.members) forCells(member, [&](int b) { block.entries[block.bucketStart[b]++] = member; });
+        for (int b = buckets; b > 0; b--) block.bucketStart[b] = block.bucketStart[b - 1];
+        block.bucketStart[0] = 0;
+        block.indexed = true;
+    }
+
+    // Clamps a view time to what's kept and allowed
+    float clampTime(float time) const {
+        float oldest = (float)newest - (float)LAG_MAX_REWIND_TICKS;
+        return std::clamp(time, std::max(oldest, 1.0f), (float)newest);
+    }
+
+    const Frame* frameAt(uint32_t tick) const {
+        const Frame& frame = frames[tick % LAG_HISTORY_TICKS];
+        return frame.tick == tick ? &frame : nullptr;
+    }
+
+    // Where an entity was at time, interpolated between the ticks around it. False if it wasn't there.
+    bool boxAt(int handle, float time, BoundingBox& box) const {
+        uint32_t tick = (uint32_t)time;
+        float t = time - (float)tick;
+        const Frame* from = frameAt(tick);
+        if (!from || handle >= (int)from->present.size() || !from->present[handle]) return false;
+        Vector3 position = from->position[handle];
+        const Frame* to = t > 0.0f ? frameAt(tick + 1) : nullptr;
+        if (to && handle < (int)to->present.size() && to->present[handle]) position = Vector3Lerp(position, to->position[handle], t);
+        box = {position - from->half[handle], position + from->half[handle]};
+        return true;
+    }
+
+    static bool overlaps(const BoundingBox& a, const BoundingBox& b) {
+        return a.min.x < b.max.x && a.max.x > b.min.x && a.min.y < b.max.y && a.max.y > b.min.y &&
+               a.min.z < b.max.z && a.max.z > b.min.z;
+    }
+
+    // Block that holds time, indexed. Null if the history doesn't reach that far back.
+    Block* indexedBlock(float time) {
+        uint32_t tick = (uint32_t)time;
+        if (tick == 0 || tick > newest || newest - tick >= LAG_HISTORY_TICKS) return nullptr;
+        uint32_t first = tick - tick % LAG_BLOCK_TICKS;
+        Block& block = blocks[(first / LAG_BLOCK_TICKS) % BLOCK_COUNT];
+        if (block.first != first) return nullptr;
+        if (!block.indexed) index(block);
+        if (++queryStamp == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            queryStamp = 1;
+        }
+        if (stamp.size() < block.present.size()) stamp.resize(block.present.size(), 0);
+        return &block;
+    }
+
+    // Appends the entities whose box overlapped area at time (clamped, see clampTime())
+    void overlapBox(float time, const BoundingBox& area, std::vector<RewindHit>& out) {
+        queries++;
+        time = clampTime(time);
+        Block* block = indexedBlock(time);
+        if (!block) return;
+        for (int cz = cellCoord(area.min.z); cz <= cellCoord(area.max.z); cz++) {
+            for (int cx = cellCoord(area.min.x); cx <= cellCoord(area.max.x); cx++) {
+                int b = bucket(*block, cx, cz);
+                for (int e = block->bucketStart[b]; e < block->bucketStart[b + 1]; e++) {
+                    int handle = block->entries[e];
+                    if (stamp[handle] == queryStamp) continue;
+                    stamp[handle] = queryStamp;
+                    if (!overlaps(block->bounds[handle], area)) continue;
+                    tested++;
+                    BoundingBox box;
+                    if (boxAt(handle, time, box) && overlaps(box, area)) out.push_back({handle, 0.0f});
+                }
+            }
+        }
+    }
+
+    // Nearest entity along the ray at time (clamped), skipping ignore. Walks the grid cells the ray crosses in order
+    // and stops once the next cell starts past the nearest hit so far or outside everyone's bounds, so an infinite
+    // maxDistance is fine. direction has to be normalized.
+    RewindHit raycast(float time, const Vector3& origin, const Vector3& direction, float maxDistance, int ignore = -1) {
+        queries++;
+        RewindHit best = {-1, maxDistance};
+        time = clampTime(time);
+        Block* block = indexedBlock(time);
+        if (!block) return best;
+        const Vector3 invDir = SceneQuery::inverse(direction);
+        const Vector3 noGrow = {0.0f, 0.0f, 0.0f};
+        int axis;
+        int cx = cellCoord(origin.x), cz = cellCoord(origin.z);
+        int stepX = direction.x > 0.0f ? 1 : -1, stepZ = direction.z > 0.0f ? 1 : -1;
+        // Distance along the ray to the next X and Z cell borders, and between borders
+        float deltaX = direction.x != 0.0f ? LAG_CELL_SIZE / fabsf(direction.x) : INFINITY;
+        float deltaZ = direction.z != 0.0f ? LAG_CELL_SIZE / fabsf(direction.z) : INFINITY;
+        float nextX = direction.x != 0.0f ? ((float)(cx + (stepX > 0)) * LAG_CELL_SIZE - origin.x) / direction.x : INFINITY;
+        float nextZ = direction.z != 0.0f ? ((float)(cz + (stepZ > 0)) * LAG_CELL_SIZE - origin.z) / direction.z : INFINITY;
+        // Where the ray leaves the XZ extent of the block, the grid is hashed and would go on forever
+        float leaves = INFINITY;
+        if (direction.x != 0.0f) leaves = fminf(leaves, ((direction.x > 0.0f ? block->extent.max.x : block->extent.min.x) - origin.x) / direction.x);
+        if (direction.z != 0.0f) leaves = fminf(leaves, ((direction.z > 0.0f ? block->extent.max.z : block->extent.min.z) - origin.z) / direction.z);
+        float entered = 0.0f;
+        // A vertical ray only ever sees its first cell, the next one is infinitely far
+        while (entered <= best.distance && entered <= leaves && std::isfinite(entered)) {
+            int b = bucket(*block, cx, cz);
+            for (int e = block->bucketStart[b]; e < block->bucketStart[b + 1]; e++) {
+                int handle = block->entries[e];
+                if (handle == ignore || stamp[handle] == queryStamp) continue;
+                stamp[handle] = queryStamp;
+                const BoundingBox& swept = block->bounds[handle];
+                if (SceneQuery::slab(origin, invDir, swept.min, swept.max, noGrow, best.distance, axis) < 0.0f) continue;
+                tested++;
+                BoundingBox box;
+                if (!boxAt(handle, time, box)) continue;
+                float distance = SceneQuery::slab(origin, invDir, box.min, box.max, noGrow, best.distance, axis);
+                if (distance >= 0.0f) best = {handle, distance};
+            }
+            if (nextX < nextZ) {
+                entered = nextX;
+                nextX += deltaX;
+                cx += stepX;
+            } else {
+                entered = nextZ;
+                nextZ += deltaZ;
+                cz += stepZ;
+            }
+        }
+        return best;
+    }
+};
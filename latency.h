@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "input_queue.h"
+
+// Fixed width histogram of latencies, 0.1 ms buckets up to 250 ms plus an overflow bucket
+struct LatencyHistogram {
+    static constexpr long long BUCKET_NS = 100'000;
+    static constexpr int BUCKETS = 2500;
+
+    std::vector<long long> counts = std::vector<long long>(BUCKETS + 1, 0);
+    long long total = 0;
+    long long sumNs = 0;
+    long long maxNs = 0;
+
+    void add(long long ns) {
+        if (ns < 0) ns = 0;
+        int bucket = (int)(ns / BUCKET_NS);
+        counts[bucket < BUCKETS ? bucket : BUCKETS]++;
+        total++;
+        sumNs += ns;
+        if (ns > maxNs) maxNs = ns;
+    }
+
+    // Upper edge of the bucket holding percentile p (0-100), in ms
+    double percentileMs(double p) const {
+        if (total == 0) return 0.0;
+        long long rank = (long long)(p / 100.0 * (double)(total - 1)) + 1;
+        long long seen = 0;
+        for (int i = 0; i <= BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) return i < BUCKETS ? (double)((i + 1) * BUCKET_NS) / 1e6 : (double)maxNs / 1e6;
+        }
+        return (double)maxNs / 1e6;
+    }
+
+    void print(FILE* out, const char* name) const {
+        if (total == 0) {
+            fprintf(out, "  %-16s no samples\n", name);
+            return;
+        }
+        fprintf(out, "  %-16s n %lld  mean %.2f  p50 %.1f  p90 %.1f  p99 %.1f  max %.2f ms\n",
+            name, total, (double)sumNs / (double)total / 1e6,
+            percentileMs(50), percentileMs(90), percentileMs(99), (double)maxNs / 1e6);
+    }
+};
+
+// Follows input events from the moment they were seen until the frame showing their effect is swapped:
+//  input     -> simulated: waiting in the queue for a tick, plus the tick itself
+//  simulated -> drawn:     until Renderer::Draw has submitted the frame containing the tick
+//  drawn     -> presented: the rest of the frame and EndDrawing (batch flush, swap, vsync wait)
+// Time after the swap until the pixels actually change (compositor, scanout) can't be seen from here.
+struct LatencyTracker {
+    struct InFlight {
+        long long input;
+        long long simulated;
+        long long drawn;
+    };
+
+    bool enabled = false;
+    std::vector<InFlight> inFlight;
+    LatencyHistogram toSimulated;
+    LatencyHistogram toDrawn;
+    LatencyHistogram toPresented;
+    LatencyHistogram endToEnd;
+
+    // A tick that consumed event has finished
+    void simulated(const InputEvent& event, long long now) {
+        if (!enabled) return;
+        inFlight.push_back({event.timeNs, now, 0});
+    }
+
+    // Renderer::Draw has returned
+    void drawn(long long now) {
+        if (!enabled) return;
+        for (InFlight& sample : inFlight) {
+            if (sample.drawn == 0) sample.drawn = now;
+        }
+    }
+
+    // EndDrawing has returned
+    void presented(long long now) {
+        if (!enabled) return;
+        for (const InFlight& sample : inFlight) {
+            if (sample.drawn == 0) continue;
+            toSimulated.add(sample.simulated - sample.input);
+            toDrawn.add(sample.drawn - sample.simulated);
+            toPresented.add(now - sample.drawn);
+            endToEnd.add(now - sample.input);
+        }
+        std::erase_if(inFlight, [](const InFlight& sample) { return sample.drawn != 0; });
+    }
+
+    // Events that will never reach the screen (e.g. the game ended on that tick)
+    void dropInFlight() {
+        inFlight.clear();
+    }
+
+    void report(FILE* out = stdout) const {
+        if (!enabled) return;
+        fprintf(out, "Input latency:\n");
+        toSimulated.print(out, "input->sim");
+        toDrawn.print(out, "sim->draw");
+        toPresented.print(out, "draw->present");
+        endToEnd.print(out, "end to end");
+    }
+};
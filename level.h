@@ -0,0 +1,61 @@
+#pragma once
+
+#include <raylib.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "world.h"
+#include "collider_merge.h"
+#include "heightfield.h"
+
+// The demo level: a ground plate with red pillars scattered over it and hills to the east. Everything random comes
+// from the seed through std::mt19937, whose output the standard fixes, so a server and its clients build the same
+// level from the seed and the plate size alone.
+struct Level {
+    Vector3 groundPos = {0.0f, 0.475f, 0.0f};
+    Vector3 groundDimensions = {30.0f, 0.05f, 30.0f};
+    Vector3 spawn = {0.0f, 1.0f, 0.0f};
+    std::vector<Collider> colliders;
+    // mergedOf maps the generated colliders to the merged ones
+    MergedColliders merged;
+    Heightfield hills;
+};
+
+// groundSize: side of the square ground plate
+inline Level GenerateLevel(unsigned seed, float groundSize = 30.0f, int numberOfPlatforms = 15)
+{
+    Level level;
+    level.groundDimensions.x = level.groundDimensions.z = groundSize;
+    std::mt19937 rng(seed);
+    // Not std::uniform_real_distribution, its output differs between standard libraries
+    auto frandSigned = [&](float range) {
+        return ((float)(rng() >> 8) / (float)(1u << 24) * 2.0f - 1.0f) * range;
+    };
+
+    Collider groundCollider = {level.groundPos, level.groundDimensions};
+    std::vector<Collider> colliders = {groundCollider};
+    for (int i = 0; i < numberOfPlatforms; i++) {
+        float x = frandSigned(groundCollider.position.x + level.groundDimensions.x * 0.5f);
+        float z = frandSigned(groundCollider.position.z + level.groundDimensions.z * 0.5f);
+        Collider collider = {{x, 0.5f, z}, {1.0f, 10.0f, 1.0f}};
+        collider.color = RED;
+        colliders.push_back(collider);
+    }
+
+    // Merge pillars that touch or overlap
+    level.merged = MergeColliders(colliders);
+    level.colliders = level.merged.colliders;
+
+    // Hilly terrain east of the ground plate, starting flush with it
+    level.hills = Heightfield(level.groundPos.x + level.groundDimensions.x * 0.5f, level.groundPos.z - level.groundDimensions.z * 0.5f, 0.5f, 120, 60);
+    for (int iz = 0; iz <= level.hills.cellsZ; iz++) {
+        for (int ix = 0; ix <= level.hills.cellsX; ix++) {
+            float x = (float)ix * level.hills.cellSize;
+            float z = (float)iz * level.hills.cellSize;
+            float rise = fminf(x / 10.0f, 1.0f);
+            level.hills.at(ix, iz) = 0.5f + rise * (1.5f + 1.5f * sinf(x * 0.3f) * cosf(z * 0.25f));
+        }
+    }
+    return level;
+}
@@ -1,202 +1,35 @@
 #include <raylib.h>
 #include <raymath.h>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <random>
 #include <ranges>
 #include <ctime>
+#include <cstring>
+#include <cstdlib>
+
+#include "world.h"
+#include "renderer.h"
+#include "collider_merge.h"
+#include "triggers.h"
+#include "hud.h"
+#include "idle_screen.h"
+#include "frame_pacer.h"
+#include "input_queue.h"
+#include "latency.h"
+#include "navigation.h"
+#include "flow_field.h"
+#include "crowd.h"
+#include "level.h"
+#include "game_client.h"
+#include "prediction.h"
+#include "player_controller.h"
 
 constexpr float GRAVITY = 0.1f;
 float acceleration = 10.f;
 Vector3 speed = {0.0f, 0.0f, 0.0f};
 
-struct Player {
-    // Constructor
-    Player(const Vector3& pos, const Vector3& dims)
-        : position(pos), dimensions(dims){}
-    // Members
-    Vector3 position;
-    Vector3 dimensions;
-    Color color = RED;
-    bool isResting = false;
-
-};
-
-struct Collider {
-    Vector3 position;
-    Vector3 dimensions;
-    Color color;
-    // According to ChatGPT using const references is more efficient (though it doesn't matter that much right now)
-    Collider(const Vector3& pos, const Vector3& dims)
-    : position(pos), dimensions(dims), color(SKYBLUE) {}
-
-};
-
-// Game world struct
-struct World {
-    // Constructor
-    World(std::vector<Collider>& colliders, Player& player)
-        : colliders(colliders), player(player) {}
-    // Members
-    std::vector<Collider>& colliders;
-    Player& player;
-
-    // Functions to resolve collision
-
-    // Repeated same logic for Z axis
-    void resolveX(Vector3& nextPos, Vector3& speed)
-    {
-        // Current max and min bounds for player
-        Vector3 maxPlayerPos = player.position + player.dimensions * 0.5f;
-        Vector3 minPlayerPos = player.position - player.dimensions * 0.5f;
-        // Obtain the next max and min bounds of the player
-        Vector3 nextMaxPlayerPos = nextPos + player.dimensions * 0.5f;
-        Vector3 nextMinPlayerPos = nextPos - player.dimensions * 0.5f;
-        for (const Collider& collider : colliders) {
-            Vector3 maxColliderPos = collider.position + collider.dimensions * 0.5f;
-            Vector3 minColliderPos = collider.position - collider.dimensions * 0.5f;
-            // Check Z and Y gating for next position
-            if (
-                // Y overlap
-                nextMaxPlayerPos.y > minColliderPos.y &&
-                nextMinPlayerPos.y < maxColliderPos.y &&
-                // Z overlap
-                nextMaxPlayerPos.z > minColliderPos.z &&
-                nextMinPlayerPos.z < maxColliderPos.z
-            ) {
-                if (
-                    maxPlayerPos.x <= minColliderPos.x && // Player still left of the collider in current pos?
-                    nextMaxPlayerPos.x > minColliderPos.x // Will next predicted position penetrate? (Approach vulnerable to tunneling)
-                ) {
-                    nextPos.x = minColliderPos.x - player.dimensions.x * 0.5f; // If true, clamp nextPos to appropriate bounds
-                    speed.x = 0.0f;
-                } else if (
-                    minPlayerPos.x >= maxColliderPos.x && // Player still to the right of the collider?
-                    nextMinPlayerPos.x < maxColliderPos.x // Will next prediction position penetrate
-                ) {
-                    nextPos.x = maxColliderPos.x + player.dimensions.x * 0.5f;
-                    speed.x = 0.0f;
-                }
-
-            }
-        }
-        // Resolve X
-        player.position.x = nextPos.x;
-    }
-
-    void resolveZ(Vector3& nextPos, Vector3& speed) {
-        Vector3 maxPlayerPos = player.position + player.dimensions * 0.5f;
-        Vector3 minPlayerPos = player.position - player.dimensions * 0.5f;
-        Vector3 nextMaxPlayerPos = nextPos + player.dimensions * 0.5f;
-        Vector3 nextMinPlayerPos = nextPos - player.dimensions * 0.5f;
-
-        for (const Collider& collider : colliders) {
-            Vector3 maxColliderPos = collider.position + collider.dimensions * 0.5f;
-            Vector3 minColliderPos = collider.position - collider.dimensions * 0.5f;
-
-            // Check X and Y overlaps for next position
-            if (
-                nextMaxPlayerPos.y > minColliderPos.y &&
-                nextMinPlayerPos.y < maxColliderPos.y &&
-                nextMaxPlayerPos.x > minColliderPos.x &&
-                nextMinPlayerPos.x < maxColliderPos.x
-                ) {
-
-                // Check collision for Z axis
-                if (
-                    speed.z < 0.0f &&
-                    minPlayerPos.z >= maxColliderPos.z &&
-                    nextMinPlayerPos.z < maxColliderPos.z
-                ) {
-                    speed.z = 0.0f;
-                    nextPos.z = maxColliderPos.z + player.dimensions.z * 0.5f;
-                } else if (
-                    speed.z > 0 &&
-                    maxPlayerPos.z <= minColliderPos.z &&
-                    nextMaxPlayerPos.z > minColliderPos.z
-                ) {
-                    speed.z = 0.0f;
-                    nextPos.z = minColliderPos.z - player.dimensions.z * 0.5f;
-                }
-            }
-        }
-        player.position.z = nextPos.z;
-    }
-
-    void resolveY(Vector3& nextPos, Vector3& speed) {
-        Vector3 maxPlayerPos = player.position + player.dimensions * 0.5f;
-        Vector3 minPlayerPos = player.position - player.dimensions * 0.5f;
-        Vector3 nextMaxPlayerPos = nextPos + player.dimensions * 0.5f;
-        Vector3 nextMinPlayerPos = nextPos - player.dimensions * 0.5f;
-
-        for (const Collider& collider : colliders) {
-            Vector3 maxColliderPos = collider.position + collider.dimensions * 0.5f;
-            Vector3 minColliderPos = collider.position - collider.dimensions * 0.5f;
-
-            if (
-                // Will next pos trigger overlap with any iterated collider?
-                maxPlayerPos.x > minColliderPos.x &&
-                minPlayerPos.x < maxColliderPos.x &&
-                maxPlayerPos.z > minColliderPos.z &&
-                minPlayerPos.z < maxColliderPos.z &&
-                nextMaxPlayerPos.y > minColliderPos.y &&
-                nextMinPlayerPos.y < maxColliderPos.y
-                ) { //If so...
-                if (// Will the player collide from the bottom of the collider?
-                    //speed.y > 0.0f &&
-                    maxPlayerPos.y <= minColliderPos.y &&
-                    nextMaxPlayerPos.y > minColliderPos.y
-                    ) {
-                    speed.y = 0.0f;
-                    nextPos.y = minColliderPos.y - player.dimensions.y * 0.5f;
-                } else if (// Or from the top?
-                    const float EPS = 0.001f; // Need to use this, otherwise imprecision will cause this not to trigger when it shouldn't
-                    minPlayerPos.y >= maxColliderPos.y -EPS &&
-                    nextMinPlayerPos.y < maxColliderPos.y
-                    ) {
-                    speed.y = 0;
-                    nextPos.y = maxColliderPos.y + player.dimensions.y * 0.5f;
-                    player.isResting = true;
-                }
-            }
-        }
-        player.position.y = nextPos.y;
-    }
-};
-
-struct Renderer {
-    const World& world;
-    Renderer(const World& world): world(world) {};
-
-    void Draw() const {
-
-        for (Collider collider : world.colliders) {
-            DrawCube(collider.position,
-                collider.dimensions.x,
-                collider.dimensions.y,
-                collider.dimensions.z,
-                collider.color);
-            DrawCubeWires(collider.position,
-                collider.dimensions.x,
-                collider.dimensions.y,
-                collider.dimensions.z,
-                BLACK);
-        }
-
-        DrawCube(world.player.position,
-            world.player.dimensions.x,
-            world.player.dimensions.y,
-            world.player.dimensions.z,
-            world.player.color);
-        DrawCubeWires(world.player.position,
-            world.player.dimensions.x,
-            world.player.dimensions.y,
-            world.player.dimensions.z,
-            BLACK);
-
-    };
-};
-
 // Functions to handle movement
 Vector3 GetCameraForwardXZ(const Camera& cam)
 {
@@ -212,8 +45,64 @@ Vector3 GetCameraRightXZ(const Camera& cam)
 }
 
 const float MIN_HEIGHT = 0.5f;
+// Speed of the --crowd agents chasing the player
+constexpr float CROWD_CHASE_SPEED = 4.0f;
+
+// Fixed simulation step
+constexpr long long TICK_NS = 1'000'000'000LL / 120;
+constexpr float TICK_DT = (float)TICK_NS / 1e9f;
+// Don't try to catch up on more than this much simulation time (e.g. after a stall)
+constexpr long long MAX_CATCH_UP_NS = 250'000'000LL;
+
+// HUD slots, one per piece of text on screen
+enum HudSlot { HUD_HINT, HUD_SPEAK, HUD_HELLO, HUD_FPS, HUD_GAME_OVER, HUD_RESTART };
+
+// Same as raylib's DrawFPS, but through the HUD so it only gets laid out again when the number changes
+void QueueFPS(Hud& hud, int x, int y)
+{
+    int fps = GetFPS();
+    Color color = LIME;
+    if (fps < 30 && fps >= 15) color = ORANGE;
+    else if (fps < 15) color = RED;
+    hud.text(HUD_FPS, TextFormat("%2i FPS", fps), x, y, 20, color);
+}
+
+int main(int argc, char** argv) {
+    // --fps 30/60/120/144/... or --fps uncapped (0)
+    // --latency to measure input to display latency, reported on exit
+    // --crowd N to have N agents chase the player
+    // --connect host[:port] to play on a game_server instead of locally
+    int targetFps = 60;
+    int crowdSize = 0;
+    const char* connectTo = nullptr;
+    LatencyTracker latency;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            targetFps = strcmp(argv[i + 1], "uncapped") == 0 ? 0 : atoi(argv[i + 1]);
+        }
+        if (strcmp(argv[i], "--latency") == 0) latency.enabled = true;
+        if (strcmp(argv[i], "--crowd") == 0 && i + 1 < argc) crowdSize = std::max(0, atoi(argv[i + 1]));
+        if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) connectTo = argv[i + 1];
+    }
+
+    // Online the server simulates, this side sends input and shows what comes back. The level is built from the
+    // server's seed.
+    srand((unsigned int)time(nullptr));
+    unsigned levelSeed = (unsigned)rand();
+    float groundSize = 30.0f;
+    GameClient client;
+    Prediction prediction;
+    bool online = connectTo != nullptr;
+    if (online) {
+        NetAddress server;
+        if (!NetAddress::parse(connectTo, server) || !client.open(server) || !client.connect(5'000'000'000LL)) {
+            std::cerr << "No game server answering at " << connectTo << std::endl;
+            return 1;
+        }
+        levelSeed = client.seed;
+        groundSize = client.groundSize;
+    }
 
-int main() {
     const int screenWidth = 1500;
     const int screenHeight = 1000;
     InitWindow(screenWidth, screenHeight, "Isometric Camera Demo");
@@ -231,163 +120,264 @@ int main() {
     Vector3 cubeDim = {0.5f, 1.0f, 0.5f};
     Player player(cubePos, cubeDim);
     // Generate colliders for the game
-    // Ground level
-    Vector3 groundDimensions = {30.0f, 0.05f, 30.0f};
-    Vector3 groundPos = {0.0f, 0.475f, 0.0f};
-    Collider groundCollider = {groundPos, groundDimensions};
-    std::vector<Collider> colliders = {groundCollider};
-    int numberOfPlatforms = 15;
+    Level level = GenerateLevel(levelSeed, groundSize);
+    std::vector<Collider>& colliders = level.colliders;
     auto frandSigned = [](float range) {
         return ((float(rand()) / float(RAND_MAX)) * 2.0f - 1.0f) * range;
     };
 
-    srand((unsigned int)time(nullptr));
-    for (int i = 0; i < numberOfPlatforms; i++) {
-
-        Vector3 pos ={
-            frandSigned(groundCollider.position.x + groundDimensions.x * 0.5f),
-            0.5f,
-            frandSigned(groundCollider.position.z + groundDimensions.z * 0.5f),
-        };
-        Vector3 dim = {
-            1.0f,
-            10.0f,
-            1.0f,
-        };
-
-        Collider collider = {pos, dim};
-        collider.color = RED;
-        colliders.push_back(collider);
-    }
-
     // Initialize nextPos to starting player position
     Vector3 nextPos = player.position;
     World world(colliders, player);
+    world.terrain = &level.hills;
+    // Crowd chasing the player: a flow field towards it, separation and alignment on top. The navigation data is only
+    // built when there's a crowd to steer, online the server's world is shown as it comes.
+    std::unique_ptr<NavGrid> navGrid;
+    std::unique_ptr<NavGraph> navGraph;
+    std::unique_ptr<FlowField> chase;
+    if (!online && crowdSize > 0) {
+        navGrid = std::make_unique<NavGrid>(BuildNavGrid(world, NavSettings{}));
+        navGraph = std::make_unique<NavGraph>(*navGrid);
+        chase = std::make_unique<FlowField>(*navGraph);
+    }
+    Crowd crowd;
+    std::vector<Vector3> crowdPositions, crowdDesired;
+    for (int attempt = 0; chase && (int)world.actors.size() < crowdSize && attempt < crowdSize * 10; attempt++) {
+        Vector3 pos = {frandSigned(level.groundDimensions.x * 0.5f - 1.0f), 1.0f, frandSigned(level.groundDimensions.z * 0.5f - 1.0f)};
+        int cell = navGrid->cellAt(pos);
+        if (cell < 0 || !navGrid->walkable[cell] || Vector3Distance(pos, player.position) < 5.0f) continue;
+        int index = world.addActor(pos, {0.5f, 1.0f, 0.5f});
+        world.actors[index].body.color = ORANGE;
+    }
     Renderer renderer(world);
-    SetTargetFPS(60);
+    Hud hud;
+    IdleScreen gameOverScreen;
+    bool lastRestartHovered = false;
+    // Pacing is done by the FramePacer, raylib shouldn't wait on top of it
+    SetTargetFPS(0);
+    FramePacer pacer(targetFps);
     DisableCursor();
     float GameOverTimer = 0.0f;
     float textTimer = 0.0f;
+    Vector3 helloAt = {5.0f, 1.0f, 5.0f};   // Above whoever was spoken to
+    uint32_t talkAnswered = 0;              // Online: newest of the server's answers to an E press shown
+    // Interaction zones
+    const int PLAYER_BODY = -1; // Trigger body id of the player, actors use their index
+    const int TALK_ZONE = 1;
+    TriggerSystem triggers;
+    triggers.add({{5.0f, 1.2f, 5.0f}, {2.0f, 0.6f, 2.0f}, TALK_ZONE});
+    std::vector<TriggerEvent> triggerEvents;
+    bool canSpeak = false;
+    // Input is queued with timestamps and consumed by fixed simulation ticks
+    InputQueue input({KEY_W, KEY_A, KEY_S, KEY_D, KEY_SPACE, KEY_E});
+    KeyState keys;
+    std::vector<InputEvent> tickEvents;
+    long long simClock = 0;
     // GAME LOOP
 
         while (!WindowShouldClose()) {
             if (GameOverTimer < 3.0f){
                 if (IsCursorOnScreen()) DisableCursor();
-                Vector3 move = {0};
                 Vector3 forward = GetCameraForwardXZ(camera);
                 Vector3 right   = GetCameraRightXZ(camera);
 
-                if (IsKeyDown(KEY_W)) move = Vector3Add(move, forward);
-                if (IsKeyDown(KEY_S)) move = Vector3Subtract(move, forward);
-                if (IsKeyDown(KEY_D)) move = Vector3Add(move, right);
-                if (IsKeyDown(KEY_A)) move = Vector3Subtract(move, right);
-
-                move = Vector3Normalize(move);
-
-                speed.x = move.x * 10.0f;
-                speed.z = move.z * 10.0f;
-
-                player.isResting = false; // reset at the start of each, resolveY will determine whether jump allowed or not
-                /*// Simple movement controls
-                if (IsKeyDown(KEY_W)) speed.z = -10.0f;
-                else if (IsKeyDown(KEY_S)) speed.z = 10.0f;
-                else speed.z = 0.0f;
-                if (IsKeyDown(KEY_A)) speed.x = -10.0f;
-                else if (IsKeyDown(KEY_D)) speed.x = 10.0f;
-                else speed.x = 0.0f;*/
-
-                // Handle lateral movement and collision
-                nextPos.x = player.position.x + speed.x * GetFrameTime();
-                world.resolveX(nextPos, speed);
-                nextPos.z = player.position.z + speed.z * GetFrameTime();
-                world.resolveZ(nextPos, speed);
-                // Handle vertical movement and collision
-                // Apply gravity
-                speed.y -= 10.5f * GetFrameTime();
-
-                nextPos.y = player.position.y + speed.y * GetFrameTime();
-                world.resolveY(nextPos, speed);
-                // Now that Y has determined if player is resting, add jump logic
-                if (IsKeyPressed(KEY_SPACE) && player.isResting) speed.y = 7.0f;
-
-                // Change player color depending on state
-                if (player.isResting) player.color = GREEN; else player.color = RED;
+                // Run the fixed simulation ticks that are due, each one applying the input that arrived before it
+                input.sample(FramePacer::nowNs());
+                // Show the latest state from the server: our own body, everyone else in view as actors
+                if (online && client.poll()) {
+                    world.actors.clear();
+                    world.awakeActors.clear();
+                    for (const EntityState& state : client.players) {
+                        if (state.id == client.id) {
+                            prediction.reconcile(world, player, nextPos, speed, state, client.acknowledged, TICK_DT);
+                        } else {
+                            int index = world.addActor(state.position, player.dimensions);
+                            world.actors[index].body.color = PURPLE;
+                        }
+                    }
+                }
+                // Online it's the server that says whether an E press reached anyone, as of what we were shown
+                if (online && client.talkSequence != talkAnswered) {
+                    talkAnswered = client.talkSequence;
+                    for (const EntityState& state : client.players) {
+                        if (client.talkingTo == 0 || state.id != client.talkingTo) continue;
+                        helloAt = state.position;
+                        textTimer = 3.0f;
+                    }
+                }
+                long long now = FramePacer::nowNs();
+                if (simClock == 0 || now - simClock > MAX_CATCH_UP_NS) simClock = now - TICK_NS;
+                while (simClock + TICK_NS <= now && GameOverTimer < 3.0f) {
+                    simClock += TICK_NS;
+                    tickEvents.clear();
+                    input.drain(simClock, tickEvents);
+                    bool jumpPressed = false;
+                    bool talkPressed = false;
+                    for (const InputEvent& event : tickEvents) {
+                        keys.apply(event);
+                        if (event.down && event.key == KEY_SPACE) jumpPressed = true;
+                        if (event.down && event.key == KEY_E) talkPressed = true;
+                    }
+
+                    Vector3 move = {0};
+                    if (keys.isDown(KEY_W)) move = Vector3Add(move, forward);
+                    if (keys.isDown(KEY_S)) move = Vector3Subtract(move, forward);
+                    if (keys.isDown(KEY_D)) move = Vector3Add(move, right);
+                    if (keys.isDown(KEY_A)) move = Vector3Subtract(move, right);
+
+                    move = Vector3Normalize(move);
+
+                    PlayerInput tickInput = {0, move.x * PLAYER_RUN_SPEED, move.z * PLAYER_RUN_SPEED, (uint8_t)jumpPressed};
+
+                    /*// Simple movement controls
+                    if (IsKeyDown(KEY_W)) speed.z = -10.0f;
+                    else if (IsKeyDown(KEY_S)) speed.z = 10.0f;
+                    else speed.z = 0.0f;
+                    if (IsKeyDown(KEY_A)) speed.x = -10.0f;
+                    else if (IsKeyDown(KEY_D)) speed.x = 10.0f;
+                    else speed.x = 0.0f;*/
+
+                    // Handle movement and collision. Online the move is predicted here and confirmed by the server later.
+                    if (online) {
+                        prediction.predict(world, player, nextPos, speed, client.sendInput(tickInput.moveX, tickInput.moveZ, jumpPressed, talkPressed), TICK_DT);
+                    } else {
+                        SimulatePlayer(world, player, nextPos, speed, tickInput, TICK_DT);
+                        if (chase && !world.actors.empty()) {
+                            crowdPositions.clear();
+                            for (const Actor& actor : world.actors) crowdPositions.push_back(actor.body.position);
+                            chase->setGoal(player.position);
+                            chase->prepare(crowdPositions);
+                            crowdDesired.clear();
+                            for (const Vector3& pos : crowdPositions) crowdDesired.push_back(chase->directionAt(pos) * CROWD_CHASE_SPEED);
+                            crowd.steer(world, crowdDesired);
+                        }
+                        world.step(TICK_DT);
+                    }
+
+                    // Change player color depending on state
+                    if (player.isResting) player.color = GREEN; else player.color = RED;
+
+                    // Update interaction zones, only membership changes come back as events
+                    triggerEvents.clear();
+                    triggers.update(PLAYER_BODY, player.position, triggerEvents);
+                    for (const TriggerEvent& event : triggerEvents) {
+                        if (triggers.triggers[event.trigger].tag == TALK_ZONE) {
+                            canSpeak = event.type != TriggerEventType::Exit;
+                        }
+                    }
+                    if (!online && canSpeak && talkPressed) {
+                        helloAt = {5.0f, 1.0f, 5.0f};
+                        textTimer = 3.0f;
+                    }
+
+                    // Game over condition
+                    // Online the server puts fallen players back on the spawn
+                    if (!online && player.position.y < 1.0f && !player.isResting) {
+                        GameOverTimer += 1.0f * TICK_DT;
+                    } else {GameOverTimer = 0.0f;}
+
+                    for (const InputEvent& event : tickEvents) latency.simulated(event, FramePacer::nowNs());
+                }
 
                 // Make camera follow player
                 Vector3 offset = {11.0f, 11.0f, 11.0f};
+                // Corrections from the server are blended in over a few frames rather than shown as a jump
+                prediction.smooth(GetFrameTime());
+                Vector3 simulatedPos = player.position;
+                player.position = prediction.shownPosition(player);
                 camera.position = Vector3Add(player.position, offset);
                 camera.target = player.position;
 
-                // Game over condition
-                if (player.position.y < 1.0f && !player.isResting) {
-                    GameOverTimer += 1.0f * GetFrameTime();
-                } else {GameOverTimer = 0.0f;}
-
                 // Raylib functions to setup everything
                 BeginDrawing();
                 ClearBackground(RAYWHITE);
                 BeginMode3D(camera);
                 renderer.Draw();
+                player.position = simulatedPos;
+                latency.drawn(FramePacer::nowNs());
                 DrawCube({5.0f, 1.0f, 5.0f}, 0.5f, 0.5f, 0.5f, BLACK);
                 DrawGrid(10, 1.0f); // 10x10 grid
                 EndMode3D();
-                DrawText("Use WASD to move the cube", 10, 10, 20, DARKGRAY);
-                if (player.position.x < 6.0f &&
-                    player.position.x > 4.0f &&
-                    player.position.z < 6.0f &&
-                    player.position.z > 4.0f &&
-                    player.position.y > 0.9f &&
-                    player.position.y < 1.5f) {
-                    DrawText("Press E to speak", 500, 500, 20, YELLOW );
-                    if (IsKeyPressed(KEY_E)) { textTimer = 3.0f;}
+                hud.text(HUD_HINT, "Use WASD to move the cube", 10, 10, 20, DARKGRAY);
+                if (canSpeak) {
+                    hud.text(HUD_SPEAK, "Press E to speak", 500, 500, 20, YELLOW );
                     }
                 if (textTimer > 0.0f) {
-                    DrawText("Hello",
-                        GetWorldToScreen({5.0f, 1.0f, 5.0f},camera).x,
-                        GetWorldToScreen({5.0f, 1.0f, 5.0f},camera).y - 50,                            15,
+                    hud.text(HUD_HELLO, "Hello",
+                        GetWorldToScreen(helloAt,camera).x,
+                        GetWorldToScreen(helloAt,camera).y - 50,                            15,
                         RED);
                     textTimer -= 1.0f * GetFrameTime();
                     }
                 if (textTimer < 0.0f) textTimer = 0.0f;
-                DrawFPS(600, 10);
+                QueueFPS(hud, 600, 10);
+                hud.flush();
                 EndDrawing();
+                // EndDrawing() polled, whatever was pressed while the frame rendered is only in raylib until the next poll
+                input.sample(FramePacer::nowNs());
+                latency.presented(FramePacer::nowNs());
+                // Keep polling input while waiting for the next frame so it gets accurate timestamps. Each poll's
+                // presses are sampled before the next one would clear them.
+                pacer.wait([&] {
+                    input.sample(FramePacer::nowNs());
+                    PollInputEvents();
+                });
                 std::cout << GameOverTimer << std::endl;
             } else {
                 if (IsCursorHidden())EnableCursor();
-                BeginDrawing();
-                ClearBackground(BLACK);
-                DrawText("GAME OVER",
-                    GetScreenWidth()/2 - MeasureText("GAME OVER", 50)/2,
-                    GetScreenHeight()/2 - 200, 50,
-                    RED);
-                DrawRectangle(GetScreenWidth()/2 - 75, GetScreenHeight()/2 - 75/2, 150, 75, GRAY);
+                // Nothing on this screen changes unless the mouse hovers the button, so only redraw then
+                gameOverScreen.enter();
 
-                Color textColor;
+                bool restartHovered = false;
 
                 if (GetMousePosition().x > GetScreenWidth()/2 -75 &&
                     GetMousePosition().x < GetScreenWidth()/2 + 75 &&
                     GetMousePosition().y > GetScreenHeight()/2 -75/2 &&
                     GetMousePosition().y < GetScreenHeight()/2 + 75/2) {
-                    textColor = RED;
+                    restartHovered = true;
                     if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
                         player.position = {
                             0.0f,
-                            groundCollider.position.y + groundDimensions.y * 0.5f + player.dimensions.y * 0.5f,
+                            level.groundPos.y + level.groundDimensions.y * 0.5f + player.dimensions.y * 0.5f,
                             0.f};
                         GameOverTimer = 0.0f;
+                        gameOverScreen.leave();
                     }
+                }
 
-                } else {textColor = GREEN;}
+                if (restartHovered != lastRestartHovered) gameOverScreen.invalidate();
+                lastRestartHovered = restartHovered;
 
-                DrawText("Restart",
-                    GetScreenWidth()/2 - MeasureText("Restart", 20)/2,
-                    GetScreenHeight()/2,
-                    20,
-                    textColor );
-                EndDrawing();
+                if (gameOverScreen.beginRedraw()) {
+                    ClearBackground(BLACK);
+                    hud.draw(HUD_GAME_OVER,
+                        GetScreenWidth()/2 - hud.layout(HUD_GAME_OVER, "GAME OVER", 50)/2,
+                        GetScreenHeight()/2 - 200,
+                        RED);
+                    DrawRectangle(GetScreenWidth()/2 - 75, GetScreenHeight()/2 - 75/2, 150, 75, GRAY);
+                    hud.draw(HUD_RESTART,
+                        GetScreenWidth()/2 - hud.layout(HUD_RESTART, "Restart", 20)/2,
+                        GetScreenHeight()/2,
+                        restartHovered ? RED : GREEN);
+                    hud.flush();
+                    gameOverScreen.endRedraw();
+                }
+                gameOverScreen.present();
+                // The idle screen waits for events on its own, but a stream of them (the mouse moving) mustn't make it
+                // spin. Start pacing and simulating afresh once back in the game.
+                pacer.throttle();
+                pacer.resync();
+                simClock = 0;
+                input.clear();
+                latency.dropInFlight();
             }
         }
 
+            gameOverScreen.unload();
+            renderer.unload();
+            client.disconnect();
+            pacer.report();
+            latency.report();
             CloseWindow();
             return 0;
         }
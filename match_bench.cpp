@@ -0,0 +1,128 @@
+// Benchmark for hosting many matches in one process
+//
+// Puts a number of small matches on a MatchHost, each a GameServer with a few NPCs and a few bot clients over
+// loopback, and runs them on the clock for a while. The bots run on the main thread next to the pool, one input per
+// tick like test_game, so on a machine with few cores they take CPU from the matches; compare --threads with the
+// core count. Reports what a match tick costs, how late ticks start, the overrun rate, and from the measured cost
+// how many such matches one core and 16 cores could carry. Headless.
+// Options:
+//     --matches A,B,C   match counts to test (default 25,50,100)
+//     --bots N          clients per match (default 4)
+//     --npcs N          NPCs per match (default 16)
+//     --threads N       pool threads (default: one per hardware thread)
+//     --seconds N       run time per count (default 5)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "game_server.h"
+#include "game_client.h"
+#include "match_host.h"
+#include "frame_pacer.h"
+
+int main(int argc, char** argv) {
+    std::vector<int> counts = {25, 50, 100};
+    int botsPerMatch = 4;
+    int npcs = 16;
+    int threads = 0;
+    double seconds = 5.0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--matches") == 0) {
+            counts.clear();
+            for (char* p = argv[i + 1]; *p; ) {
+                counts.push_back(std::clamp((int)strtol(p, &p, 10), 1, 10000));
+                if (*p == ',') p++;
+                else break;
+            }
+        } else if (strcmp(argv[i], "--bots") == 0) {
+            botsPerMatch = std::clamp(atoi(argv[i + 1]), 0, 64);
+        } else if (strcmp(argv[i], "--npcs") == 0) {
+            npcs = std::clamp(atoi(argv[i + 1]), 0, 10000);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = std::max(0, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = std::max(1.0, atof(argv[i + 1]));
+        }
+    }
+
+    const double budgetMs = 1000.0 / SERVER_TICK_RATE;
+    for (int count : counts) {
+        MatchHost host(threads);
+        std::vector<std::unique_ptr<GameClient>> bots;
+        std::mt19937 rng(count);
+        std::uniform_real_distribution<float> spread(-13.0f, 13.0f);
+        std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+        for (int m = 0; m < count; m++) {
+            GameServer& server = host.add(std::make_unique<GameServer>(1000 + (unsigned)m));
+            for (int i = 0; i < npcs; i++) server.addNpc({spread(rng), 1.0f, spread(rng)});
+            if (!server.listen(0, true)) {
+                fprintf(stderr, "Can't open the socket of match %d\n", m);
+                return 1;
+            }
+            for (int b = 0; b < botsPerMatch; b++) {
+                bots.push_back(std::make_unique<GameClient>());
+                if (!bots.back()->open({0x7f000001u, server.socket.localPort()}, true)) {
+                    fprintf(stderr, "Can't open a client socket\n");
+                    return 1;
+                }
+            }
+        }
+        host.start();
+
+        std::vector<float> heading(bots.size());
+        for (float& h : heading) h = angle(rng);
+        const long long tickNs = 1'000'000'000LL / SERVER_TICK_RATE;
+        long long start = FramePacer::nowNs();
+        long long measureFrom = start + 1'000'000'000LL;    // A second to connect and settle
+        long long end = measureFrom + (long long)(seconds * 1e9);
+        bool measuring = false;
+        int botTicks = 0;
+        for (long long deadline = start; deadline < end; deadline += tickNs) {
+            FramePacer::sleepUntilNs(deadline);
+            if (!measuring && deadline >= measureFrom) {
+                host.collect();     // Drop the warm up
+                measuring = true;
+            }
+            for (size_t b = 0; b < bots.size(); b++) {
+                GameClient& bot = *bots[b];
+                bot.poll();
+                if (!bot.welcomed) {
+                    if (botTicks % (SERVER_TICK_RATE / 10) == 0) bot.sendHello();
+                    continue;
+                }
+                if (rng() % 120 == 0) heading[b] = angle(rng);
+                if (const EntityState* self = bot.self()) {
+                    if (fabsf(self->position.x) > 12.0f || fabsf(self->position.z) > 12.0f) {
+                        heading[b] = atan2f(-self->position.z, -self->position.x);
+                    }
+                }
+                bot.sendInput(cosf(heading[b]) * PLAYER_RUN_SPEED, sinf(heading[b]) * PLAYER_RUN_SPEED, rng() % 200 == 0);
+            }
+            botTicks++;
+        }
+        std::vector<MatchStats> perMatch;
+        MatchStats stats = host.collect(&perMatch);
+        host.stop();
+        for (auto& bot : bots) bot->disconnect();
+
+        int overrunning = 0;
+        for (const MatchStats& match : perMatch) overrunning += match.overruns > 0;
+        double ticks = (double)std::max(stats.ticks, 1LL);
+        double expected = seconds * SERVER_TICK_RATE * count;
+        double tickMs = stats.busyMs / ticks;
+        printf("%4d matches on %d threads, %d clients: %.1f%% of due ticks run, tick %.3f ms average, %.3f ms worst, "
+               "%.3f ms late on average, %.2f%% overruns in %d matches, %lld skips, %.1f kB/s out, "
+               "about %d such matches per core, %d per 16 cores\n",
+            count, host.threadCount, stats.clients, 100.0 * ticks / expected, tickMs, stats.worstMs, stats.lateMs / ticks,
+            100.0 * (double)stats.overruns / ticks, overrunning, stats.skipped, (double)stats.bytesOut / seconds / 1000.0,
+            (int)(budgetMs / tickMs), (int)(16.0 * budgetMs / tickMs));
+    }
+    return 0;
+}
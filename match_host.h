@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "game_server.h"
+#include "frame_pacer.h"
+
+constexpr long long MATCH_TICK_NS = 1'000'000'000LL / SERVER_TICK_RATE;
+constexpr int MATCH_MAX_BEHIND_TICKS = 4;   // A match further behind than this skips ahead instead of catching up
+
+// Tick timing of one match, or summed over all of them
+struct MatchStats {
+    long long ticks = 0;
+    long long overruns = 0;     // Ticks that finished after the next one was due
+    long long skipped = 0;      // Times the match fell too far behind and gave up catching up
+    double busyMs = 0.0;
+    double worstMs = 0.0;
+    double lateMs = 0.0;        // Summed time ticks waited past their deadline for a free thread
+    int clients = 0;            // Connected after the last tick
+    long long bytesOut = 0;
+
+    void add(const MatchStats& other) {
+        clients += other.clients;
+        bytesOut += other.bytesOut;
+        ticks += other.ticks;
+        overruns += other.overruns;
+        skipped += other.skipped;
+        busyMs += other.busyMs;
+        worstMs = std::max(worstMs, other.worstMs);
+        lateMs += other.lateMs;
+    }
+};
+
+struct Match {
+    std::unique_ptr<GameServer> server;
+    long long deadline = 0;     // When its next tick is due
+    MatchStats stats;           // Since the last collect(), guarded by MatchHost::mutex
+    long long bytesOut = 0;     // server->bytesOut at the last tick
+};
+
+// Hosts many independent matches, each a GameServer with its own World and socket, on one pool of threads. Ticks
+// are scheduled earliest deadline first from one queue: a free thread takes the match whose tick is due soonest,
+// runs its receive() and tick(), and puts it back due one tick later. A match is in the queue at most once, so it
+// never runs on two threads at a time and GameServer needs no locking. Starting deadlines are spread over one tick
+// so the matches don't all fall due together. Add the matches, then start().
+struct MatchHost {
+    int threadCount;
+    std::vector<std::unique_ptr<Match>> matches;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    // (deadline, match index), soonest on top
+    using Due = std::pair<long long, int>;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> due;
+    bool running = false;
+
+    explicit MatchHost(int threads = 0)
+        : threadCount(threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency())) {}
+    ~MatchHost() { stop(); }
+    MatchHost(const MatchHost&) = delete;
+    MatchHost& operator=(const MatchHost&) = delete;
+
+    GameServer& add(std::unique_ptr<GameServer> server) {
+        matches.push_back(std::make_unique<Match>());
+        matches.back()->server = std::move(server);
+        return *matches.back()->server;
+    }
+
+    void start() {
+        long long now = FramePacer::nowNs();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < (int)matches.size(); i++) {
+                matches[i]->deadline = now + MATCH_TICK_NS * i / (long long)matches.size();
+                due.push({matches[i]->deadline, i});
+            }
+            running = true;
+        }
+        for (int t = 0; t < threadCount; t++) workers.emplace_back([this] { work(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+        workers.clear();
+        due = {};
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            if (due.empty()) {
+                wake.wait(lock);
+                continue;
+            }
+            Due next = due.top();
+            long long now = FramePacer::nowNs();
+            if (next.first > now) {
+                wake.wait_for(lock, std::chrono::nanoseconds(next.first - now));
+                continue;
+            }
+            due.pop();
+            // Someone else may take the next match while this one runs
+            if (!due.empty()) wake.notify_one();
+            lock.unlock();
+
+            Match& match = *matches[next.second];
+            long long start = FramePacer::nowNs();
+            match.server->receive();
+            match.server->tick();
+            long long end = FramePacer::nowNs();
+
+            lock.lock();
+            double ms = (double)(end - start) / 1e6;
+            MatchStats& stats = match.stats;
+            stats.ticks++;
+            stats.busyMs += ms;
+            stats.worstMs = std::max(stats.worstMs, ms);
+            stats.lateMs += (double)(start - match.deadline) / 1e6;
+            stats.clients = (int)match.server->clients.size();
+            stats.bytesOut += match.server->bytesOut - match.bytesOut;
+            match.bytesOut = match.server->bytesOut;
+            match.deadline += MATCH_TICK_NS;
+            if (end > match.deadline) stats.overruns++;
+            if (end - match.deadline > MATCH_MAX_BEHIND_TICKS * MATCH_TICK_NS) {
+                stats.skipped++;
+                match.deadline = end;
+            }
+            due.push({match.deadline, next.second});
+            wake.notify_one();
+        }
+    }
+
+    // Sums the stats of every match since the last call and starts them over. perMatch, if given, gets each one.
+    MatchStats collect(std::vector<MatchStats>* perMatch = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        MatchStats total;
+        if (perMatch) perMatch->clear();
+        for (const std::unique_ptr<Match>& match : matches) {
+            total.add(match->stats);
+            if (perMatch) perMatch->push_back(match->stats);
+            int clients = match->stats.clients;
+            match->stats = {};
+            match->stats.clients = clients;
+        }
+        return total;
+    }
+};
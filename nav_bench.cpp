@@ -0,0 +1,243 @@
+// Benchmark for the navigation grid and hierarchical pathfinding
+//
+// Rasterizes a generated pillar level (same density as main()) into a navigation grid, builds the HPA* graph and
+// answers random path requests: on one thread, through PathRequestQueue on several, and again to measure the cache.
+// A sample of paths is checked against plain A* over the whole grid for reachability and length. Then a crowd
+// chases the player with a FlowField while the player walks across the level. Headless.
+// Options:
+//     --grid N          grid cells per side (default 1000)
+//     --requests N      random path requests (default 20000)
+//     --threads N       queue worker threads (default: every hardware thread)
+//     --cluster N       cluster size in cells (default 16)
+//     --density F       pillars per 60 square units, main() has 1 (default 1)
+//     --agents N        flow field crowd size (default 500)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "world.h"
+#include "collider_merge.h"
+#include "navigation.h"
+#include "flow_field.h"
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Plain A* over the whole grid, for reference
+float ReferenceCost(const NavGrid& grid, int start, int goal)
+{
+    std::vector<float> cost(grid.walkable.size(), INFINITY);
+    std::vector<std::pair<float, int>> heap;
+    auto order = [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; };
+    int goalX = goal % grid.width, goalZ = goal / grid.width;
+    cost[start] = 0.0f;
+    heap.push_back({0.0f, start});
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), order);
+        auto [priority, cell] = heap.back();
+        heap.pop_back();
+        int x = cell % grid.width, z = cell / grid.width;
+        if (priority > cost[cell] + NavDistance(x, z, goalX, goalZ) + 1e-3f) continue;
+        if (cell == goal) return cost[cell];
+        for (const auto& d : NAV_DIRECTIONS) {
+            if (!grid.canMove(x, z, d[0], d[1])) continue;
+            int next = cell + d[1] * grid.width + d[0];
+            float total = cost[cell] + (d[0] != 0 && d[1] != 0 ? NAV_DIAGONAL_COST : 1.0f);
+            if (total >= cost[next]) continue;
+            cost[next] = total;
+            heap.push_back({total + NavDistance(x + d[0], z + d[1], goalX, goalZ), next});
+            std::push_heap(heap.begin(), heap.end(), order);
+        }
+    }
+    return -1.0f;
+}
+
+float PathCost(const NavGrid& grid, int start, const std::vector<int>& cells)
+{
+    float total = 0.0f;
+    int previous = start;
+    for (int cell : cells) {
+        bool diagonal = cell % grid.width != previous % grid.width && cell / grid.width != previous / grid.width;
+        total += diagonal ? NAV_DIAGONAL_COST : 1.0f;
+        previous = cell;
+    }
+    return total;
+}
+
+int main(int argc, char** argv) {
+    int cells = 1000;
+    int requests = 20000;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int clusterSize = 16;
+    float density = 1.0f;
+    int agents = 500;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--grid") == 0) cells = std::max(16, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--requests") == 0) requests = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--threads") == 0) threads = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--cluster") == 0) clusterSize = std::max(4, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--density") == 0) density = (float)atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--agents") == 0) agents = std::max(1, atoi(argv[i + 1]));
+    }
+
+    NavSettings settings;
+    float half = (float)cells * settings.cellSize * 0.5f;
+    int pillars = (int)(4.0f * half * half / 60.0f * density);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> spread(-half, half);
+    std::vector<Collider> colliders = {Collider({0.0f, 0.475f, 0.0f}, {half * 2.0f, 0.05f, half * 2.0f})};
+    for (int i = 0; i < pillars; i++) colliders.push_back(Collider({spread(rng), 0.5f, spread(rng)}, {1.0f, 10.0f, 1.0f}));
+    colliders = MergeColliders(colliders).colliders;
+    Player player({0.0f, 1.0f, 0.0f}, {0.5f, 1.0f, 0.5f});
+    World world(colliders, player);
+
+    auto gridStart = std::chrono::steady_clock::now();
+    NavGrid grid = BuildNavGrid(world, settings);
+    double gridMs = MsSince(gridStart);
+    auto graphStart = std::chrono::steady_clock::now();
+    NavGraph graph(grid, clusterSize, threads);
+    double graphMs = MsSince(graphStart);
+    size_t edgeCount = 0;
+    for (const std::vector<NavEdge>& out : graph.edges) edgeCount += out.size();
+    printf("grid %dx%d, %d colliders, built in %.1f ms\n", grid.width, grid.height, (int)colliders.size(), gridMs);
+    printf("graph %dx%d clusters of %d, %d nodes, %d edges, built in %.1f ms on %d threads\n",
+        graph.clustersX, graph.clustersZ, clusterSize, (int)graph.nodeCells.size(), (int)edgeCount, graphMs, threads);
+
+    // Random walkable start and goal pairs anywhere on the level
+    std::vector<std::pair<Vector3, Vector3>> pairs;
+    std::uniform_int_distribution<int> anyCell(0, grid.width * grid.height - 1);
+    auto randomPoint = [&] {
+        int cell;
+        do cell = anyCell(rng); while (!grid.walkable[cell]);
+        return grid.center(cell);
+    };
+    while ((int)pairs.size() < requests) pairs.push_back({randomPoint(), randomPoint()});
+
+    PathSearch search(graph);
+    std::vector<int> path;
+    std::vector<Vector3> waypoints;
+    int found = 0;
+    auto singleStart = std::chrono::steady_clock::now();
+    for (const auto& [from, to] : pairs) found += search.find(from, to, path, waypoints);
+    double singleMs = MsSince(singleStart);
+    printf("1 thread:   %d requests in %.1f ms, %.0f paths/s, %d found\n", requests, singleMs, requests / (singleMs / 1000.0), found);
+
+    {
+        PathRequestQueue queue(graph, threads, (size_t)requests);
+        std::vector<PathResult> results;
+        auto queueStart = std::chrono::steady_clock::now();
+        for (const auto& [from, to] : pairs) queue.request(from, to);
+        queue.finish();
+        queue.collect(results);
+        double queueMs = MsSince(queueStart);
+        printf("queue:      %d requests in %.1f ms, %.0f paths/s on %d threads\n", (int)results.size(), queueMs, requests / (queueMs / 1000.0), threads);
+
+        results.clear();
+        auto cachedStart = std::chrono::steady_clock::now();
+        for (const auto& [from, to] : pairs) queue.request(from, to);
+        queue.finish();
+        queue.collect(results);
+        double cachedMs = MsSince(cachedStart);
+        printf("cached:     %d requests in %.1f ms, %.0f paths/s, %lld cache hits\n", (int)results.size(), cachedMs, requests / (cachedMs / 1000.0), queue.cacheHits.load());
+    }
+
+    // Compare against full grid A* on a sample
+    int samples = std::min(requests, 200);
+    int disagree = 0;
+    double ratioSum = 0.0, worst = 1.0;
+    int compared = 0;
+    for (int i = 0; i < samples; i++) {
+        int start = grid.cellAt(pairs[i].first), goal = grid.cellAt(pairs[i].second);
+        bool ok = search.findCells(start, goal, path);
+        float reference = ReferenceCost(grid, start, goal);
+        if (ok != (reference >= 0.0f)) disagree++;
+        if (!ok || reference <= 0.0f) continue;
+        double ratio = PathCost(grid, start, path) / reference;
+        ratioSum += ratio;
+        worst = std::max(worst, ratio);
+        compared++;
+    }
+    printf("vs grid A*: %d of %d disagree on reachability, path length %.3fx on average, %.3fx at worst\n",
+        disagree, samples, compared ? ratioSum / compared : 1.0, worst);
+
+    // Flow field: the player walks across the level, the crowd around it gets its tiles prepared every time the
+    // player's cell changes
+    FlowField field(graph);
+    auto fullStart = std::chrono::steady_clock::now();
+    field.setGoal(pairs[0].first);
+    field.prepareAll(threads);
+    printf("flow field: whole grid built in %.1f ms (%d tiles)\n", MsSince(fullStart), field.tilesBuilt);
+
+    std::vector<Vector3> walk;
+    search.find(pairs[0].first, pairs[0].second, path, walk);
+    std::vector<Vector3> crowd;
+    std::vector<int> steps;
+    for (size_t i = 0; i < path.size(); i++) steps.push_back(path[i]);
+    std::uniform_real_distribution<float> around(-40.0f, 40.0f);
+    int goalChanges = 0;
+    long long built = 0, shifted = 0;
+    double updateMs = 0.0, lookupMs = 0.0;
+    Vector3 sum = {0.0f, 0.0f, 0.0f};
+    for (int cell : steps) {
+        Vector3 goal = grid.center(cell);
+        // Keep the crowd around the player, like it would be while chasing
+        crowd.clear();
+        std::mt19937 placement(cell);
+        while ((int)crowd.size() < agents) {
+            Vector3 p = {goal.x + around(placement), goal.y, goal.z + around(placement)};
+            int at = grid.cellAt(p);
+            if (at >= 0 && grid.walkable[at]) crowd.push_back(p);
+        }
+        auto updateStart = std::chrono::steady_clock::now();
+        field.setGoal(goal);
+        field.prepare(crowd, threads);
+        updateMs += MsSince(updateStart);
+        goalChanges++;
+        built += field.tilesBuilt;
+        shifted += field.tilesShifted;
+
+        auto lookupStart = std::chrono::steady_clock::now();
+        for (const Vector3& p : crowd) sum = sum + field.directionAt(p);
+        lookupMs += MsSince(lookupStart);
+    }
+    printf("flow field: %d goal changes, %.3f ms each on average, %lld tiles built, %lld shifted, %.1f ns per lookup\n",
+        goalChanges, updateMs / std::max(1, goalChanges), built, shifted,
+        lookupMs * 1e6 / std::max(1.0, (double)goalChanges * agents) + 0.0 * sum.x);
+
+    // Following the field from the crowd reaches the goal, at about the shortest distance
+    int reached = 0, followed = 0;
+    double lengthSum = 0.0, longest = 1.0;
+    field.prepareAll(threads);
+    for (int i = 0; i < std::min(agents, 200); i++) {
+        int cell = grid.cellAt(crowd[i]);
+        float expected = ReferenceCost(grid, cell, field.goal);
+        if (expected < 0.0f) continue;
+        followed++;
+        float walked = 0.0f;
+        for (int step = 0; step < grid.width * 4 && cell != field.goal; step++) {
+            unsigned char d = field.direction[cell];
+            if (d == FlowField::NO_DIRECTION) break;
+            walked += d >= 4 ? NAV_DIAGONAL_COST : 1.0f;
+            cell += NAV_DIRECTIONS[d][1] * grid.width + NAV_DIRECTIONS[d][0];
+        }
+        if (cell != field.goal) continue;
+        reached++;
+        if (expected > 0.0f) {
+            lengthSum += walked / expected;
+            longest = std::max(longest, (double)(walked / expected));
+        }
+    }
+    printf("flow field: %d of %d agents reach the goal following it, %.3fx the shortest distance on average, %.3fx at worst\n",
+        reached, followed, reached ? lengthSum / reached : 1.0, longest);
+    return 0;
+}
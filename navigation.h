@@ -0,0 +1,658 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "world.h"
+#include "parallel.h"
+
+// What the navigation grid is built for: walkers of radius agentRadius and height agentHeight on a floor at floorY.
+// Colliders whose top is within stepHeight of the floor are floor, colliders reaching into the agent's body above
+// that are obstacles. Terrain isn't rasterized.
+struct NavSettings {
+    float cellSize = 0.5f;
+    float floorY = 0.5f;
+    float agentRadius = 0.3f;
+    float agentHeight = 1.0f;
+    float stepHeight = 0.3f;
+};
+
+// Walkable cells on the XZ plane. Cell (x, z) covers [originX + x * cellSize, +cellSize) and the same on Z,
+// cells are indexed z * width + x.
+struct NavGrid {
+    float originX = 0.0f;
+    float originZ = 0.0f;
+    float cellSize = 1.0f;
+    float floorY = 0.0f;
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> walkable;
+    std::vector<int> region;        // Connected area per cell, -1 for blocked cells. Different regions never connect.
+    unsigned generation = 0;        // World::colliderGeneration it was built from
+
+    bool inside(int x, int z) const { return x >= 0 && z >= 0 && x < width && z < height; }
+    bool open(int x, int z) const { return inside(x, z) && walkable[(size_t)z * width + x]; }
+
+    // Cell under a point, -1 outside the grid
+    int cellAt(const Vector3& p) const {
+        int x = (int)floorf((p.x - originX) / cellSize);
+        int z = (int)floorf((p.z - originZ) / cellSize);
+        return inside(x, z) ? z * width + x : -1;
+    }
+
+    Vector3 center(int cell) const {
+        return {originX + ((float)(cell % width) + 0.5f) * cellSize, floorY, originZ + ((float)(cell / width) + 0.5f) * cellSize};
+    }
+
+    // 8 way moves, diagonals only when both cells beside them are open too so paths don't clip corners
+    bool canMove(int x, int z, int dx, int dz) const {
+        if (!open(x + dx, z + dz)) return false;
+        return dx == 0 || dz == 0 || (open(x + dx, z) && open(x, z + dz));
+    }
+};
+
+constexpr float NAV_DIAGONAL_COST = 1.41421356f;
+// Searches inflate the distance estimate this much, so among the many equally good cells of an open area the one
+// closer to the goal goes first. Paths come out at most 0.1% longer, searches expand far fewer cells.
+constexpr float NAV_TIE_BREAK = 1.001f;
+// Same for the abstract search, where entrances make many near equal routes. Halves its work on open levels,
+// with no measurable effect on path length (HPA* paths are a few percent off the shortest anyway).
+constexpr float NAV_ABSTRACT_WEIGHT = 1.02f;
+// Opposite directions are next to each other, d ^ 1 turns around
+constexpr int NAV_DIRECTIONS[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {-1, -1}, {1, -1}, {-1, 1}};
+
+// Octile distance in cells, exact on an empty grid
+inline float NavDistance(int fromX, int fromZ, int toX, int toZ)
+{
+    int dx = abs(toX - fromX);
+    int dz = abs(toZ - fromZ);
+    return (float)std::max(dx, dz) + (NAV_DIAGONAL_COST - 1.0f) * (float)std::min(dx, dz);
+}
+
+// Rasterizes the world's colliders onto a grid covering the floor colliders. A cell is walkable when its center is
+// on a floor collider and at least agentRadius away (on X and Z) from every obstacle.
+inline NavGrid BuildNavGrid(const World& world, const NavSettings& settings)
+{
+    NavGrid grid;
+    grid.cellSize = settings.cellSize;
+    grid.floorY = settings.floorY;
+    grid.generation = world.colliderGeneration;
+
+    auto isFloor = [&](const Vector3& max) { return fabsf(max.y - settings.floorY) <= settings.stepHeight; };
+    Vector3 lo = {INFINITY, 0.0f, INFINITY};
+    Vector3 hi = {-INFINITY, 0.0f, -INFINITY};
+    for (const Collider& collider : world.colliders) {
+        // Same bounds the resolver computes
+        Vector3 max = collider.position + collider.dimensions * 0.5f;
+        Vector3 min = collider.position - collider.dimensions * 0.5f;
+        if (!isFloor(max)) continue;
+        lo = Vector3Min(lo, min);
+        hi = Vector3Max(hi, max);
+    }
+    if (lo.x > hi.x) return grid;
+    grid.originX = lo.x;
+    grid.originZ = lo.z;
+    grid.width = std::max(1, (int)ceilf((hi.x - lo.x) / settings.cellSize));
+    grid.height = std::max(1, (int)ceilf((hi.z - lo.z) / settings.cellSize));
+    grid.walkable.assign((size_t)grid.width * grid.height, 0);
+
+    // Cells whose centers lie inside [minX, maxX) x [minZ, maxZ)
+    auto mark = [&](float minX, float maxX, float minZ, float maxZ, unsigned char value) {
+        int x0 = std::max(0, (int)ceilf((minX - grid.originX) / grid.cellSize - 0.5f));
+        int x1 = std::min(grid.width - 1, (int)ceilf((maxX - grid.originX) / grid.cellSize - 0.5f) - 1);
+        int z0 = std::max(0, (int)ceilf((minZ - grid.originZ) / grid.cellSize - 0.5f));
+        int z1 = std::min(grid.height - 1, (int)ceilf((maxZ - grid.originZ) / grid.cellSize - 0.5f) - 1);
+        if (x0 > x1) return;
+        for (int z = z0; z <= z1; z++) {
+            std::fill(grid.walkable.begin() + (size_t)z * grid.width + x0, grid.walkable.begin() + (size_t)z * grid.width + x1 + 1, value);
+        }
+    };
+    // Floors first, then cut the obstacles out of them
+    for (const Collider& collider : world.colliders) {
+        Vector3 max = collider.position + collider.dimensions * 0.5f;
+        Vector3 min = collider.position - collider.dimensions * 0.5f;
+        if (isFloor(max)) mark(min.x, max.x, min.z, max.z, 1);
+    }
+    for (const Collider& collider : world.colliders) {
+        Vector3 max = collider.position + collider.dimensions * 0.5f;
+        Vector3 min = collider.position - collider.dimensions * 0.5f;
+        if (isFloor(max) || max.y <= settings.floorY + settings.stepHeight || min.y >= settings.floorY + settings.agentHeight) continue;
+        float r = settings.agentRadius;
+        mark(min.x - r, max.x + r, min.z - r, max.z + r, 0);
+    }
+
+    // Flood fill the connected regions, so unreachable goals are rejected without a search
+    grid.region.assign(grid.walkable.size(), -1);
+    std::vector<int> open;
+    int regions = 0;
+    for (int start = 0; start < (int)grid.walkable.size(); start++) {
+        if (!grid.walkable[start] || grid.region[start] >= 0) continue;
+        grid.region[start] = regions;
+        open.push_back(start);
+        while (!open.empty()) {
+            int cell = open.back();
+            open.pop_back();
+            int x = cell % grid.width, z = cell / grid.width;
+            for (const auto& d : NAV_DIRECTIONS) {
+                if (!grid.canMove(x, z, d[0], d[1])) continue;
+                int next = cell + d[1] * grid.width + d[0];
+                if (grid.region[next] >= 0) continue;
+                grid.region[next] = regions;
+                open.push_back(next);
+            }
+        }
+        regions++;
+    }
+    return grid;
+}
+
+struct NavRect {
+    int x0, z0, x1, z1;     // Inclusive
+    int width() const { return x1 - x0 + 1; }
+    bool contains(int x, int z) const { return x >= x0 && x <= x1 && z >= z0 && z <= z1; }
+};
+
+struct NavEdge {
+    int to;
+    float cost;
+    int pathFirst = 0;      // In-cluster edges: cells of the path in NavGraph::edgeCells of the node it leaves
+    int pathCount = 0;
+};
+
+// Abstract graph for hierarchical pathfinding (HPA*): the grid is cut into square clusters, every stretch of open
+// border between two clusters gets an entrance (a node on each side, joined by a one cell step) and the nodes of a
+// cluster are joined by the cost of the shortest path between them inside it. Long paths are searched on this
+// small graph and then refined one cluster at a time. Read only once built, so any number of threads can search it.
+struct NavGraph {
+    static constexpr int ENTRANCE_SPLIT = 6;   // Border stretches at least this long get an entrance at each end
+
+    const NavGrid& grid;
+    int clusterSize;
+    int clustersX = 0;
+    int clustersZ = 0;
+    std::vector<int> nodeCells;                 // Grid cell of each node
+    std::vector<std::vector<NavEdge>> edges;    // Per node
+    std::vector<std::vector<int>> edgeCells;    // Per node, the paths of its in-cluster edges back to back
+    std::vector<std::vector<int>> clusterNodes; // Per cluster
+    std::unordered_map<int, int> nodeAt;        // Grid cell to node
+
+    NavGraph(const NavGrid& grid, int clusterSize = 16, int threads = 0);
+
+    int clusterOf(int cell) const {
+        return (cell / grid.width / clusterSize) * clustersX + (cell % grid.width) / clusterSize;
+    }
+
+    NavRect clusterRect(int cluster) const {
+        int x0 = (cluster % clustersX) * clusterSize;
+        int z0 = (cluster / clustersX) * clusterSize;
+        return {x0, z0, std::min(grid.width, x0 + clusterSize) - 1, std::min(grid.height, z0 + clusterSize) - 1};
+    }
+
+    int addNode(int cell) {
+        auto it = nodeAt.find(cell);
+        if (it != nodeAt.end()) return it->second;
+        int node = (int)nodeCells.size();
+        nodeCells.push_back(cell);
+        edges.emplace_back();
+        edgeCells.emplace_back();
+        clusterNodes[clusterOf(cell)].push_back(node);
+        nodeAt[cell] = node;
+        return node;
+    }
+
+    // Entrances along the border between cell (x, z) + i * step and its neighbour at + across, for i in [0, length)
+    void addEntrances(int x, int z, int stepX, int stepZ, int acrossX, int acrossZ, int length) {
+        auto link = [&](int i) {
+            int a = (z + i * stepZ) * grid.width + x + i * stepX;
+            int b = a + acrossZ * grid.width + acrossX;
+            int na = addNode(a);
+            int nb = addNode(b);
+            edges[na].push_back({nb, 1.0f});
+            edges[nb].push_back({na, 1.0f});
+        };
+        int run = 0;
+        for (int i = 0; i <= length; i++) {
+            bool open = i < length && grid.open(x + i * stepX, z + i * stepZ) &&
+                        grid.open(x + i * stepX + acrossX, z + i * stepZ + acrossZ);
+            if (open) {
+                run++;
+                continue;
+            }
+            if (run >= ENTRANCE_SPLIT) {
+                link(i - run);
+                link(i - 1);
+            } else if (run > 0) {
+                link(i - run + run / 2);
+            }
+            run = 0;
+        }
+    }
+};
+
+// Per thread search state over a NavGraph: scratch buffers reused across searches so they don't allocate
+struct PathSearch {
+    const NavGraph& graph;
+    const NavGrid& grid;
+    // Local searches inside a rectangle (a cluster, or two)
+    std::vector<float> localCost;
+    std::vector<int> localParent;
+    std::vector<unsigned> localSeen;
+    std::vector<unsigned char> localClosed;
+    unsigned localStamp = 0;
+    // Abstract search, two extra slots for the start and goal
+    std::vector<float> nodeCost;
+    std::vector<int> nodeParent;
+    std::vector<unsigned> nodeSeen;
+    unsigned nodeStamp = 0;
+    std::vector<std::pair<float, int>> heap;
+    std::vector<NavEdge> startEdges;
+    std::vector<NavEdge> goalEdges;
+    std::vector<int> abstractPath;
+
+    explicit PathSearch(const NavGraph& graph)
+        : graph(graph), grid(graph.grid),
+          localCost((size_t)4 * graph.clusterSize * graph.clusterSize), localParent(localCost.size()),
+          localSeen(localCost.size(), 0), localClosed(localCost.size(), 0),
+          nodeCost(graph.nodeCells.size() + 2), nodeParent(nodeCost.size()), nodeSeen(nodeCost.size(), 0) {}
+
+    static bool heapOrder(const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; }
+
+    // Dijkstra (goal < 0) or A* (goal >= 0) from source, only over cells inside rect. Afterwards localCost holds
+    // the cost of every cell reached (localSeen == localStamp), indexed by position inside rect.
+    bool searchRect(int source, int goal, const NavRect& rect) {
+        if (++localStamp == 0) {
+            std::fill(localSeen.begin(), localSeen.end(), 0);
+            localStamp = 1;
+        }
+        int w = rect.width();
+        int goalX = goal >= 0 ? goal % grid.width : 0, goalZ = goal >= 0 ? goal / grid.width : 0;
+        auto local = [&](int cell) { return (cell / grid.width - rect.z0) * w + cell % grid.width - rect.x0; };
+        auto estimate = [&](int cell) { return goal >= 0 ? NavDistance(cell % grid.width, cell / grid.width, goalX, goalZ) * NAV_TIE_BREAK : 0.0f; };
+
+        heap.clear();
+        int s = local(source);
+        localSeen[s] = localStamp;
+        localClosed[s] = 0;
+        localCost[s] = 0.0f;
+        localParent[s] = -1;
+        heap.push_back({estimate(source), source});
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), heapOrder);
+            int cell = heap.back().second;
+            heap.pop_back();
+            int l = local(cell);
+            if (localClosed[l]) continue;
+            localClosed[l] = 1;
+            if (cell == goal) return true;
+            int x = cell % grid.width, z = cell / grid.width;
+            for (const auto& d : NAV_DIRECTIONS) {
+                if (!rect.contains(x + d[0], z + d[1]) || !grid.canMove(x, z, d[0], d[1])) continue;
+                int next = cell + d[1] * grid.width + d[0];
+                int n = local(next);
+                float cost = localCost[l] + (d[0] != 0 && d[1] != 0 ? NAV_DIAGONAL_COST : 1.0f);
+                if (localSeen[n] == localStamp && (localClosed[n] || localCost[n] <= cost)) continue;
+                localSeen[n] = localStamp;
+                localClosed[n] = 0;
+                localCost[n] = cost;
+                localParent[n] = cell;
+                heap.push_back({cost + estimate(next), next});
+                std::push_heap(heap.begin(), heap.end(), heapOrder);
+            }
+        }
+        return goal < 0;
+    }
+
+    // Cost from source to target after searchRect(source, ...), -1 if it wasn't reached
+    float reachedCost(int target, const NavRect& rect) const {
+        int l = (target / grid.width - rect.z0) * rect.width() + target % grid.width - rect.x0;
+        return localSeen[l] == localStamp && localClosed[l] ? localCost[l] : -1.0f;
+    }
+
+    // Appends the cells after source up to goal, after a successful searchRect(source, goal, rect)
+    void appendLocalPath(int goal, const NavRect& rect, std::vector<int>& cells) const {
+        size_t from = cells.size();
+        for (int cell = goal; ; ) {
+            int parent = localParent[(cell / grid.width - rect.z0) * rect.width() + cell % grid.width - rect.x0];
+            if (parent < 0) break;
+            cells.push_back(cell);
+            cell = parent;
+        }
+        std::reverse(cells.begin() + from, cells.end());
+    }
+
+    // Edges from a cell to the nodes of its cluster, for the start and goal of a search
+    void connect(int cell, std::vector<NavEdge>& out) {
+        out.clear();
+        int cluster = graph.clusterOf(cell);
+        NavRect rect = graph.clusterRect(cluster);
+        searchRect(cell, -1, rect);
+        for (int node : graph.clusterNodes[cluster]) {
+            float cost = reachedCost(graph.nodeCells[node], rect);
+            if (cost >= 0.0f) out.push_back({node, cost});
+        }
+    }
+
+    // Shortest path (near shortest, HPA* gives up a little for speed) from start to goal cell. cells gets every
+    // cell after start up to and including goal.
+    bool findCells(int start, int goal, std::vector<int>& cells) {
+        cells.clear();
+        if (start < 0 || goal < 0 || !grid.walkable[start] || !grid.walkable[goal]) return false;
+        if (grid.region[start] != grid.region[goal]) return false;
+        if (start == goal) return true;
+
+        // Same or neighbouring cluster: a direct search over both usually finds the way
+        int startCluster = graph.clusterOf(start);
+        int goalCluster = graph.clusterOf(goal);
+        NavRect a = graph.clusterRect(startCluster);
+        NavRect b = graph.clusterRect(goalCluster);
+        if (abs(a.x0 - b.x0) <= graph.clusterSize && abs(a.z0 - b.z0) <= graph.clusterSize) {
+            NavRect both = {std::min(a.x0, b.x0), std::min(a.z0, b.z0), std::max(a.x1, b.x1), std::max(a.z1, b.z1)};
+            if (searchRect(start, goal, both)) {
+                appendLocalPath(goal, both, cells);
+                return true;
+            }
+        }
+
+        // Abstract A* with start and goal as temporary nodes
+        int startNode = (int)graph.nodeCells.size();
+        int goalNode = startNode + 1;
+        connect(start, startEdges);
+        connect(goal, goalEdges);
+        int goalX = goal % grid.width, goalZ = goal / grid.width;
+        auto estimate = [&](int node) {
+            int cell = node == startNode ? start : graph.nodeCells[node];
+            return NavDistance(cell % grid.width, cell / grid.width, goalX, goalZ) * NAV_ABSTRACT_WEIGHT;
+        };
+        if (++nodeStamp == 0) {
+            std::fill(nodeSeen.begin(), nodeSeen.end(), 0);
+            nodeStamp = 1;
+        }
+        heap.clear();
+        nodeSeen[startNode] = nodeStamp;
+        nodeCost[startNode] = 0.0f;
+        nodeParent[startNode] = -1;
+        heap.push_back({estimate(startNode), startNode});
+        bool found = false;
+        auto relax = [&](int from, int to, float cost) {
+            float total = nodeCost[from] + cost;
+            if (nodeSeen[to] == nodeStamp && nodeCost[to] <= total) return;
+            nodeSeen[to] = nodeStamp;
+            nodeCost[to] = total;
+            nodeParent[to] = from;
+            heap.push_back({total + (to == goalNode ? 0.0f : estimate(to)), to});
+            std::push_heap(heap.begin(), heap.end(), heapOrder);
+        };
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), heapOrder);
+            auto [priority, node] = heap.back();
+            heap.pop_back();
+            if (node == goalNode) {
+                found = true;
+                break;
+            }
+            // Stale heap entry
+            if (priority > nodeCost[node] + estimate(node) + 1e-4f) continue;
+            const std::vector<NavEdge>& out = node == startNode ? startEdges : graph.edges[node];
+            for (const NavEdge& edge : out) relax(node, edge.to, edge.cost);
+            if (node != startNode && graph.clusterOf(graph.nodeCells[node]) == goalCluster) {
+                for (const NavEdge& edge : goalEdges) if (edge.to == node) relax(node, goalNode, edge.cost);
+            }
+        }
+        if (!found) return false;
+
+        abstractPath.clear();
+        for (int node = goalNode; node >= 0; node = nodeParent[node]) abstractPath.push_back(node);
+        std::reverse(abstractPath.begin(), abstractPath.end());
+
+        // Refine: consecutive nodes are either one step across a border or joined inside a cluster, by a path
+        // stored with the edge or, for the start and goal, searched again
+        auto cellOf = [&](int node) { return node == goalNode ? goal : node == startNode ? start : graph.nodeCells[node]; };
+        for (size_t i = 1; i < abstractPath.size(); i++) {
+            int fromNode = abstractPath[i - 1];
+            int toNode = abstractPath[i];
+            int from = cellOf(fromNode);
+            int to = cellOf(toNode);
+            if (from == to) continue;
+            int cluster = graph.clusterOf(from);
+            if (cluster != graph.clusterOf(to)) {
+                cells.push_back(to);
+                continue;
+            }
+            if (fromNode != startNode && toNode != goalNode) {
+                for (const NavEdge& edge : graph.edges[fromNode]) {
+                    if (edge.to != toNode || edge.pathCount == 0) continue;
+                    const int* path = graph.edgeCells[fromNode].data() + edge.pathFirst;
+                    cells.insert(cells.end(), path, path + edge.pathCount);
+                    break;
+                }
+                continue;
+            }
+            NavRect rect = graph.clusterRect(cluster);
+            if (!searchRect(from, to, rect)) return false;
+            appendLocalPath(to, rect, cells);
+        }
+        return true;
+    }
+
+    // Path between two points as waypoints at cell centers, only keeping the cells where the direction changes.
+    // The last waypoint is the goal cell's center.
+    bool find(const Vector3& from, const Vector3& to, std::vector<int>& cells, std::vector<Vector3>& waypoints) {
+        waypoints.clear();
+        int start = grid.cellAt(from);
+        if (!findCells(start, grid.cellAt(to), cells)) return false;
+        int previous = start;
+        for (size_t i = 0; i < cells.size(); i++) {
+            bool last = i + 1 == cells.size();
+            if (!last && cells[i + 1] - cells[i] == cells[i] - previous) {
+                previous = cells[i];
+                continue;
+            }
+            waypoints.push_back(grid.center(cells[i]));
+            previous = cells[i];
+        }
+        return true;
+    }
+};
+
+inline NavGraph::NavGraph(const NavGrid& grid, int clusterSize, int threads)
+    : grid(grid), clusterSize(clusterSize)
+{
+    clustersX = (grid.width + clusterSize - 1) / clusterSize;
+    clustersZ = (grid.height + clusterSize - 1) / clusterSize;
+    clusterNodes.resize((size_t)clustersX * clustersZ);
+
+    // Entrances on every vertical and horizontal cluster border
+    for (int cz = 0; cz < clustersZ; cz++) {
+        for (int cx = 0; cx < clustersX; cx++) {
+            NavRect rect = clusterRect(cz * clustersX + cx);
+            if (cx + 1 < clustersX) addEntrances(rect.x1, rect.z0, 0, 1, 1, 0, rect.z1 - rect.z0 + 1);
+            if (cz + 1 < clustersZ) addEntrances(rect.x0, rect.z1, 1, 0, 0, 1, rect.x1 - rect.x0 + 1);
+        }
+    }
+
+    // Join the nodes of each cluster, clusters don't share nodes so they can go in parallel
+    ParallelFor((int)clusterNodes.size(), threads, [&](int begin, int end) {
+        PathSearch search(*this);
+        for (int cluster = begin; cluster < end; cluster++) {
+            NavRect rect = clusterRect(cluster);
+            for (int node : clusterNodes[cluster]) {
+                search.searchRect(nodeCells[node], -1, rect);
+                for (int other : clusterNodes[cluster]) {
+                    if (other == node) continue;
+                    float cost = search.reachedCost(nodeCells[other], rect);
+                    if (cost < 0.0f) continue;
+                    int first = (int)edgeCells[node].size();
+                    search.appendLocalPath(nodeCells[other], rect, edgeCells[node]);
+                    edges[node].push_back({other, cost, first, (int)edgeCells[node].size() - first});
+                }
+            }
+        }
+    }, 16);
+}
+
+// Finished paths by (start cell, goal cell), least recently used ones dropped first. Thread safe.
+struct PathCache {
+    struct Entry {
+        unsigned long long key;
+        bool found;
+        std::vector<Vector3> waypoints;
+    };
+
+    size_t capacity;
+    std::mutex mutex;
+    std::list<Entry> entries;   // Most recently used first
+    std::unordered_map<unsigned long long, std::list<Entry>::iterator> index;
+
+    explicit PathCache(size_t capacity = 4096) : capacity(capacity) {}
+
+    static unsigned long long key(int start, int goal) { return ((unsigned long long)(unsigned)start << 32) | (unsigned)goal; }
+
+    bool get(int start, int goal, bool& found, std::vector<Vector3>& waypoints) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key(start, goal));
+        if (it == index.end()) return false;
+        entries.splice(entries.begin(), entries, it->second);
+        found = it->second->found;
+        waypoints = it->second->waypoints;
+        return true;
+    }
+
+    void put(int start, int goal, bool found, const std::vector<Vector3>& waypoints) {
+        std::lock_guard<std::mutex> lock(mutex);
+        unsigned long long k = key(start, goal);
+        if (index.count(k)) return;
+        entries.push_front({k, found, waypoints});
+        index[k] = entries.begin();
+        if (entries.size() > capacity) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        index.clear();
+    }
+};
+
+struct PathRequest {
+    int id;
+    Vector3 from;
+    Vector3 to;
+};
+
+struct PathResult {
+    int id;
+    bool found;
+    std::vector<Vector3> waypoints;
+};
+
+// Path requests answered by worker threads. Queue them any time from the game thread and pick up whatever is
+// done with collect(), usually once per frame. Workers take requests in batches to keep locking rare. The graph
+// has to outlive the queue and stay unchanged while it runs (stop the queue, rebuild the grid and graph, then
+// start a new one when colliders change).
+struct PathRequestQueue {
+    static constexpr int BATCH = 32;
+
+    const NavGraph& graph;
+    PathCache cache;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable idle;
+    std::vector<PathRequest> pending;
+    std::vector<PathResult> done;
+    std::vector<std::thread> workers;
+    int nextId = 0;
+    int inFlight = 0;           // Taken by a worker but not done yet
+    bool stopping = false;
+    std::atomic<long long> cacheHits{0};
+
+    PathRequestQueue(const NavGraph& graph, int threads = 0, size_t cacheSize = 4096) : graph(graph), cache(cacheSize) {
+        if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < threads; i++) workers.emplace_back([this] { work(); });
+    }
+
+    ~PathRequestQueue() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeWorkers.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    PathRequestQueue(const PathRequestQueue&) = delete;
+    PathRequestQueue& operator=(const PathRequestQueue&) = delete;
+
+    int request(const Vector3& from, const Vector3& to) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int id = nextId++;
+        pending.push_back({id, from, to});
+        wakeWorkers.notify_one();
+        return id;
+    }
+
+    // Moves every finished result into out (appending)
+    void collect(std::vector<PathResult>& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (PathResult& result : done) out.push_back(std::move(result));
+        done.clear();
+    }
+
+    // Blocks until every queued request is answered
+    void finish() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return pending.empty() && inFlight == 0; });
+    }
+
+    void work() {
+        PathSearch search(graph);
+        std::vector<PathRequest> batch;
+        std::vector<PathResult> results;
+        std::vector<int> cells;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeWorkers.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (stopping) return;
+                // Oldest requests first
+                size_t take = std::min(pending.size(), (size_t)BATCH);
+                batch.assign(pending.begin(), pending.begin() + take);
+                pending.erase(pending.begin(), pending.begin() + take);
+                inFlight += (int)take;
+            }
+            results.clear();
+            for (const PathRequest& request : batch) {
+                PathResult result = {request.id, false, {}};
+                int start = graph.grid.cellAt(request.from);
+                int goal = graph.grid.cellAt(request.to);
+                if (cache.get(start, goal, result.found, result.waypoints)) {
+                    cacheHits++;
+                } else {
+                    result.found = search.find(request.from, request.to, cells, result.waypoints);
+                    cache.put(start, goal, result.found, result.waypoints);
+                }
+                results.push_back(std::move(result));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (PathResult& result : results) done.push_back(std::move(result));
+                inFlight -= (int)batch.size();
+                if (pending.empty() && inFlight == 0) idle.notify_all();
+                if (!pending.empty()) wakeWorkers.notify_one();
+            }
+        }
+    }
+};
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <raylib.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+// Keep windows.h from declaring the GDI and USER functions whose names clash with raylib's (Rectangle, CloseWindow...)
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Network plumbing shared by the game server and its clients: addresses, a non-blocking UDP socket and little
+// helpers to write and read packets. Packets are plain structs of fixed size fields copied in and out, both ends
+// are little endian x86.
+
+// Bump when any packet layout changes, servers ignore clients with another version
+constexpr uint16_t NET_PROTOCOL_VERSION = 6;
+constexpr int NET_DEFAULT_PORT = 7777;
+// Stay under the usual internet MTU so nothing gets fragmented
+constexpr int NET_MAX_PACKET = 1200;
+
+struct NetAddress {
+    uint32_t ip = 0;        // Host byte order
+    uint16_t port = 0;
+
+    bool operator==(const NetAddress& other) const { return ip == other.ip && port == other.port; }
+
+    std::string toString() const {
+        char text[32];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u:%u", ip >> 24, (ip >> 16) & 255, (ip >> 8) & 255, ip & 255, port);
+        return text;
+    }
+
+    // "host", "host:port" or ":port", resolving host names. Returns false if the host can't be found.
+    static bool parse(const std::string& text, NetAddress& address, int defaultPort = NET_DEFAULT_PORT) {
+        size_t colon = text.rfind(':');
+        std::string host = colon == std::string::npos ? text : text.substr(0, colon);
+        address.port = (uint16_t)(colon == std::string::npos ? defaultPort : atoi(text.c_str() + colon + 1));
+        if (host.empty()) host = "127.0.0.1";
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* found = nullptr;
+        if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || !found) return false;
+        address.ip = ntohl(((sockaddr_in*)found->ai_addr)->sin_addr.s_addr);
+        freeaddrinfo(found);
+        return true;
+    }
+};
+
+// Non-blocking IPv4 UDP socket
+struct UdpSocket {
+#if defined(_WIN32)
+    using Handle = SOCKET;
+    static constexpr Handle INVALID = INVALID_SOCKET;
+#else
+    using Handle = int;
+    static constexpr Handle INVALID = -1;
+#endif
+    Handle handle = INVALID;
+
+    UdpSocket() = default;
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+    UdpSocket(UdpSocket&& other) noexcept : handle(other.handle) { other.handle = INVALID; }
+    UdpSocket& operator=(UdpSocket&& other) noexcept {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    ~UdpSocket() { close(); }
+
+    // Port 0 picks a free one, see localPort(). Loopback only binds to 127.0.0.1.
+    bool open(uint16_t port = 0, bool loopback = false, int bufferBytes = 1 << 20) {
+#if defined(_WIN32)
+        static bool started = [] {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        if (!started) return false;
+#endif
+        close();
+        handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (handle == INVALID) return false;
+        // Bigger kernel buffers, a server answering many clients sends in bursts
+        setsockopt(handle, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferBytes, sizeof(bufferBytes));
+        setsockopt(handle, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferBytes, sizeof(bufferBytes));
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+        if (bind(handle, (const sockaddr*)&local, sizeof(local)) != 0) {
+            close();
+            return false;
+        }
+#if defined(_WIN32)
+        u_long nonBlocking = 1;
+        ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+        fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+        return true;
+    }
+
+    void close() {
+        if (handle == INVALID) return;
+#if defined(_WIN32)
+        closesocket(handle);
+#else
+        ::close(handle);
+#endif
+        handle = INVALID;
+    }
+
+    bool isOpen() const { return handle != INVALID; }
+
+    uint16_t localPort() const {
+        sockaddr_in local = {};
+        socklen_t length = sizeof(local);
+        if (getsockname(handle, (sockaddr*)&local, &length) != 0) return 0;
+        return ntohs(local.sin_port);
+    }
+
+    bool send(const NetAddress& to, const void* data, int size) const {
+        sockaddr_in target = {};
+        target.sin_family = AF_INET;
+        target.sin_port = htons(to.port);
+        target.sin_addr.s_addr = htonl(to.ip);
+        return sendto(handle, (const char*)data, size, 0, (const sockaddr*)&target, sizeof(target)) == size;
+    }
+
+    // Size of the packet read, or -1 when nothing is waiting
+    int receive(void* data, int capacity, NetAddress& from) const {
+        sockaddr_in source = {};
+        socklen_t length = sizeof(source);
+        int size = (int)recvfrom(handle, (char*)data, capacity, 0, (sockaddr*)&source, &length);
+        if (size < 0) return -1;
+        from.ip = ntohl(source.sin_addr.s_addr);
+        from.port = ntohs(source.sin_port);
+        return size;
+    }
+};
+
+// Appends fixed size values to a packet buffer. Overflowing sets failed instead of writing past the end.
+struct NetWriter {
+    uint8_t* data;
+    int capacity;
+    int size = 0;
+    bool failed = false;
+
+    NetWriter(void* data, int capacity) : data((uint8_t*)data), capacity(capacity) {}
+
+    template<typename T>
+    void put(const T& value) {
+        if (size + (int)sizeof(T) > capacity) {
+            failed = true;
+            return;
+        }
+        memcpy(data + size, &value, sizeof(T));
+        size += (int)sizeof(T);
+    }
+
+    int remaining() const { return capacity - size; }
+};
+
+// Reads values back in the order they were written. Reading past the end returns zeros and sets failed, so a
+// truncated or malicious packet can be checked for once at the end.
+struct NetReader {
+    const uint8_t* data;
+    int size;
+    int offset = 0;
+    bool failed = false;
+
+    NetReader(const void* data, int size) : data((const uint8_t*)data), size(size) {}
+
+    template<typename T>
+    T get() {
+        T value = {};
+        if (offset + (int)sizeof(T) > size) {
+            failed = true;
+            return value;
+        }
+        memcpy(&value, data + offset, sizeof(T));
+        offset += (int)sizeof(T);
+        return value;
+    }
+
+    int remaining() const { return size - offset; }
+};
+
+// Packet types, the first byte of every packet
+enum class NetMessage : uint8_t {
+    Hello = 1,      // Client -> server: u16 protocol version
+    Welcome,        // Server -> client: u16 entity id of the client's player, u32 level seed, u16 ground size, u16 tick rate
+    Input,          // Client -> server: u32 newest snapshot tick decoded, u8 count, then count PlayerInputs, newest first
+    State,          // Server -> client: u32 tick, u32 baseline tick (0: none), u32 last input sequence applied for this
+                    //                   client, u8 part, u8 parts, then the next piece of the encoded snapshot (see
+                    //                   snapshot.h). Every part but the last is NET_STATE_PIECE bytes.
+    Bye,            // Either way, no payload
+    Spectate,       // Client -> server: u16 protocol version. Joins as a spectator, answered with a Welcome for
+                    // entity 0. Repeat about once a second to stay on.
+    Talk,           // Server -> client: u32 sequence of the input with the E press, u16 entity it reached (0: nobody)
+};
+
+constexpr int NET_STATE_HEADER = 1 + 4 + 4 + 4 + 1 + 1;
+constexpr int NET_STATE_PIECE = NET_MAX_PACKET - NET_STATE_HEADER;
+constexpr int NET_MAX_SNAPSHOT = 255 * NET_STATE_PIECE;
+
+// Writes one part of an encoded snapshot as a State packet into out (NET_MAX_PACKET bytes), returns its size
+inline int WriteStatePart(uint8_t* out, uint32_t tick, uint32_t baseline, uint32_t inputAck, int part, int parts,
+                          const uint8_t* piece, int size)
+{
+    NetWriter writer(out, NET_MAX_PACKET);
+    writer.put(NetMessage::State);
+    writer.put(tick);
+    writer.put(baseline);
+    writer.put(inputAck);
+    writer.put((uint8_t)part);
+    writer.put((uint8_t)parts);
+    memcpy(out + writer.size, piece, size);
+    return writer.size + size;
+}
+
+// One simulation tick worth of player input. Clients send the last few with every packet so a lost one is
+// covered by the next.
+struct PlayerInput {
+    uint32_t sequence = 0;
+    float moveX = 0.0f;     // Desired horizontal velocity
+    float moveZ = 0.0f;
+    uint8_t jump = 0;
+    uint8_t interact = 0;   // E pressed this tick
+};
+
+// Authoritative state of one body, a player or a server driven actor
+struct EntityState {
+    uint16_t id = 0;
+    Vector3 position = {0.0f, 0.0f, 0.0f};
+    Vector3 speed = {0.0f, 0.0f, 0.0f};
+    uint8_t resting = 0;
+};
+
+inline void WriteInput(NetWriter& writer, const PlayerInput& input)
+{
+    writer.put(input.sequence);
+    writer.put(input.moveX);
+    writer.put(input.moveZ);
+    writer.put(input.jump);
+    writer.put(input.interact);
+}
+
+inline PlayerInput ReadInput(NetReader& reader)
+{
+    PlayerInput input;
+    input.sequence = reader.get<uint32_t>();
+    input.moveX = reader.get<float>();
+    input.moveZ = reader.get<float>();
+    input.jump = reader.get<uint8_t>();
+    input.interact = reader.get<uint8_t>();
+    return input;
+}
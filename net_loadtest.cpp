@@ -0,0 +1,111 @@
+// Loopback load test for the game server
+//
+// Runs a GameServer and N bot clients in one process over real UDP sockets on 127.0.0.1. The bots wander and jump
+// at random, one input per tick like test_game. Ticks run back to back instead of on the clock, and only the
+// server's part (receive and tick) is timed, so the numbers are the server's CPU cost per tick. Repeats for every
+// client count and estimates how many clients one core can serve at SERVER_TICK_RATE.
+// Options:
+//     --clients A,B,C   client counts to test (default 1,8,32,128,256)
+//     --ticks N         ticks per run (default 600)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "game_server.h"
+#include "game_client.h"
+#include "frame_pacer.h"
+
+int main(int argc, char** argv) {
+    std::vector<int> counts = {1, 8, 32, 128, 256};
+    int ticks = 600;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--clients") == 0) {
+            counts.clear();
+            for (char* p = argv[i + 1]; *p; ) {
+                counts.push_back(std::max(1, (int)strtol(p, &p, 10)));
+                if (*p == ',') p++;
+                else break;
+            }
+        } else if (strcmp(argv[i], "--ticks") == 0) {
+            ticks = std::max(1, atoi(argv[i + 1]));
+        }
+    }
+
+    const double budgetMs = 1000.0 / SERVER_TICK_RATE;
+    printf("%d ticks per run at %d Hz, budget %.2f ms per tick\n", ticks, SERVER_TICK_RATE, budgetMs);
+    int bestFit = 0;
+    double perClientMs = 0.0;
+    for (int count : counts) {
+        GameServer server(1234);
+        if (!server.listen(0, true)) {
+            fprintf(stderr, "Can't open the server socket\n");
+            return 1;
+        }
+        NetAddress address = {0x7f000001u, server.socket.localPort()};
+        std::vector<std::unique_ptr<GameClient>> bots;
+        for (int i = 0; i < count; i++) {
+            bots.push_back(std::make_unique<GameClient>());
+            if (!bots.back()->open(address, true)) {
+                fprintf(stderr, "Can't open client socket %d\n", i);
+                return 1;
+            }
+            bots.back()->sendHello();
+        }
+        for (int attempt = 0; attempt < 100 && (int)server.clients.size() < count; attempt++) {
+            server.receive();
+            FramePacer::sleepUntilNs(FramePacer::nowNs() + 1'000'000);
+        }
+        for (auto& bot : bots) bot->poll();
+        int welcomed = 0;
+        for (auto& bot : bots) welcomed += bot->welcomed;
+
+        std::mt19937 rng(count);
+        std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+        std::vector<float> heading(count);
+        for (float& h : heading) h = angle(rng);
+        long long bytesBefore = server.bytesOut, packetsBefore = server.packetsOut;
+        double busyMs = 0.0, worstMs = 0.0;
+        for (int tick = 0; tick < ticks; tick++) {
+            for (int i = 0; i < count; i++) {
+                // Turn now and then, jump now and then
+                if (rng() % 120 == 0) heading[i] = angle(rng);
+                bots[i]->sendInput(cosf(heading[i]) * PLAYER_RUN_SPEED, sinf(heading[i]) * PLAYER_RUN_SPEED, rng() % 200 == 0);
+            }
+            long long start = FramePacer::nowNs();
+            server.receive();
+            server.tick();
+            double ms = (double)(FramePacer::nowNs() - start) / 1e6;
+            busyMs += ms;
+            worstMs = std::max(worstMs, ms);
+            for (auto& bot : bots) bot->poll();
+        }
+
+        long long snapshots = 0, complete = 0;
+        for (auto& bot : bots) {
+            snapshots += bot->snapshots;
+            complete += bot->self() != nullptr;
+        }
+        double average = busyMs / ticks;
+        double seconds = (double)ticks / SERVER_TICK_RATE;
+        printf("%4d clients (%d welcomed): %.3f ms per tick (%.1f%% of budget), worst %.3f ms, %.0f packets/s, %.1f kB/s out, %.1f kB/s per client, %.0f snapshots/s per client\n",
+            count, welcomed, average, average / budgetMs * 100.0, worstMs,
+            (double)(server.packetsOut - packetsBefore) / seconds, (double)(server.bytesOut - bytesBefore) / seconds / 1000.0,
+            (double)(server.bytesOut - bytesBefore) / seconds / 1000.0 / count, (double)snapshots / count / seconds);
+        if (complete != count) printf("     %lld clients never saw themselves\n", (long long)(count - complete));
+        if (average <= budgetMs) bestFit = std::max(bestFit, count);
+        perClientMs = average / count;
+        for (auto& bot : bots) bot->disconnect();
+    }
+    printf("largest tested count that fits a tick on one core: %d clients", bestFit);
+    // On the small level every client has every player in view, so the cost grows with the square of the count
+    if (perClientMs > 0.0) printf(", about %d at the quadratic rate of the last run\n", (int)(counts.back() * sqrt(budgetMs / (perClientMs * counts.back()))));
+    else printf("\n");
+    return 0;
+}
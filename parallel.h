@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Threads kept for ParallelFor, so a call costs waking a few of them rather than creating and joining threads.
+// Any number of callers can share it at once (MatchHost's threads each ticking a match, say): their ranges go in one
+// queue, and a caller waiting for its own ranges runs whatever is queued meanwhile, so a ParallelFor inside a
+// ParallelFor can't leave everyone waiting. The pool only grows, up to the most threads ever asked for.
+struct WorkerPool {
+    struct Task {
+        void (*run)(void* fn, int begin, int end);
+        void* fn;
+        int begin, end;
+        std::atomic<int>* left;     // Ranges of the call still running or queued
+    };
+    std::mutex mutex;
+    std::condition_variable wake;   // Tasks queued, or stopping
+    std::condition_variable done;   // Some call's last range finished
+    std::deque<Task> tasks;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    static WorkerPool& shared() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    WorkerPool() = default;
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Queues the tasks, making sure there are workers enough to run them all at once
+    void submit(const Task* first, int count) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while ((int)workers.size() < count) workers.emplace_back([this] { work(); });
+            tasks.insert(tasks.end(), first, first + count);
+        }
+        if (count == 1) wake.notify_one();
+        else wake.notify_all();
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            Task task = tasks.front();
+            tasks.pop_front();
+            lock.unlock();
+            run(task);
+            lock.lock();
+        }
+    }
+
+    void run(const Task& task) {
+        task.run(task.fn, task.begin, task.end);
+        if (task.left->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+
+    // Returns once left drops to 0, running queued tasks, anyone's, rather than sleeping while there are some
+    void finish(std::atomic<int>& left) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (left.load(std::memory_order_acquire) > 0) {
+            if (tasks.empty()) {
+                done.wait(lock);
+                continue;
+            }
+            Task task = tasks.front();
+            tasks.pop_front();
+            lock.unlock();
+            run(task);
+            lock.lock();
+        }
+    }
+};
+
+// How many ranges ParallelFor splits count items into: threads <= 0 means one per hardware thread, and no range
+// gets fewer than minPerThread items
+inline int ParallelRanges(int count, int threads, int minPerThread = 256)
+{
+    if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    return std::max(1, std::min(threads, count / std::max(1, minPerThread)));
+}
+
+// Splits [0, count) into ParallelRanges() contiguous ranges and runs fn(begin, end) on each, the calling thread
+// taking the first range and WorkerPool::shared() the rest. Small jobs run inline.
+template<typename Fn>
+void ParallelFor(int count, int threads, Fn&& fn, int minPerThread = 256)
+{
+    threads = ParallelRanges(count, threads, minPerThread);
+    if (threads <= 1) {
+        fn(0, count);
+        return;
+    }
+    using Body = std::remove_reference_t<Fn>;
+    std::vector<WorkerPool::Task> tasks;
+    tasks.reserve(threads - 1);
+    std::atomic<int> left{0};
+    int per = (count + threads - 1) / threads;
+    for (int t = 1; t < threads; t++) {
+        int begin = t * per;
+        int end = std::min(count, begin + per);
+        if (begin >= end) break;
+        tasks.push_back({[](void* body, int begin, int end) { (*(Body*)body)(begin, end); },
+            const_cast<void*>(static_cast<const void*>(&fn)), begin, end, &left});
+    }
+    left.store((int)tasks.size(), std::memory_order_relaxed);
+    WorkerPool& pool = WorkerPool::shared();
+    if (!tasks.empty()) pool.submit(tasks.data(), (int)tasks.size());
+    fn(0, std::min(count, per));
+    pool.finish(left);
+}
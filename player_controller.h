@@ -0,0 +1,21 @@
+#pragma once
+
+#include <raylib.h>
+
+#include "world.h"
+#include "net.h"
+
+constexpr float PLAYER_RUN_SPEED = 10.0f;
+constexpr float PLAYER_JUMP_SPEED = 7.0f;
+const Vector3 PLAYER_DIMENSIONS = {0.5f, 1.0f, 0.5f};
+
+// One tick of player movement, the same everywhere it runs: the local game, the server (through World::step for
+// actors, which does the same thing) and client prediction replaying inputs. Velocity on XZ comes straight from the
+// input, the step resolves collisions and decides whether the body rests, and only a resting body can jump.
+inline void SimulatePlayer(World& world, Player& body, Vector3& nextPos, Vector3& speed, const PlayerInput& input, float dt)
+{
+    speed.x = input.moveX;
+    speed.z = input.moveZ;
+    world.stepBody(body, nextPos, speed, dt);
+    if (input.jump && body.isResting) speed.y = PLAYER_JUMP_SPEED;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <cmath>
+#include <cstdint>
+
+#include "world.h"
+#include "net.h"
+#include "player_controller.h"
+#include "snapshot.h"
+
+constexpr int PREDICTION_HISTORY = 256;             // Inputs kept for replay, a power of two. 2 s at 120 Hz.
+constexpr float PREDICTION_SMOOTHING_RATE = 12.0f;  // How fast a correction is blended out, per second
+constexpr float PREDICTION_SNAP_DISTANCE = 2.0f;    // Corrections bigger than this aren't blended, just taken
+// Smaller misses don't trigger a replay. The server's state arrives quantized, so two quanta of slack: one for the
+// rounding of what it sends, one for whatever rounding the last correction left in ours.
+constexpr float PREDICTION_POSITION_TOLERANCE = 2.0f / (float)SnapshotSettings{}.positionScale;
+constexpr float PREDICTION_SPEED_TOLERANCE = 2.0f / (float)SnapshotSettings{}.speedScale;
+
+struct PredictedState {
+    Vector3 position;
+    Vector3 speed;
+    bool resting;
+};
+
+// Client side prediction for the local player. Every input is simulated right away with the same SimulatePlayer()
+// the server uses and kept in a ring with the state it led to. When the server's state for an acknowledged input
+// comes back, it's compared to what was predicted for that input; on a miss the body is put where the server says
+// and the inputs the server hasn't seen yet are replayed on top. The jump in position that causes is kept as an
+// offset that shrinks every frame, so the player sees the cube slide rather than teleport.
+struct Prediction {
+    PlayerInput inputs[PREDICTION_HISTORY];
+    PredictedState states[PREDICTION_HISTORY];  // State right after the input in the same slot
+    uint32_t newest = 0;        // Sequence of the last predicted input
+    uint32_t acknowledged = 0;  // Sequence of the last input the server confirmed
+    bool synced = false;        // Had a state from the server at all, acknowledged 0 is a real ack after that
+    Vector3 errorOffset = {0.0f, 0.0f, 0.0f};   // Shown position minus simulated position
+    // Statistics
+    long long checked = 0, corrections = 0, replayed = 0;
+    double errorSum = 0.0;
+    float worstError = 0.0f;
+
+    static int slot(uint32_t sequence) { return (int)(sequence & (PREDICTION_HISTORY - 1)); }
+
+    // Runs the input on the local body right away
+    void predict(World& world, Player& body, Vector3& nextPos, Vector3& speed, const PlayerInput& input, float dt) {
+        SimulatePlayer(world, body, nextPos, speed, input, dt);
+        newest = input.sequence;
+        inputs[slot(newest)] = input;
+        states[slot(newest)] = {body.position, speed, body.isResting};
+    }
+
+    // server: our body on the server right after it simulated input ack
+    void reconcile(World& world, Player& body, Vector3& nextPos, Vector3& speed, const EntityState& server, uint32_t ack, float dt) {
+        // Nothing new, or out of order. Until the server runs our first input every state says ack 0, only the
+        // first of those puts the body where the server has it.
+        if (synced && ack <= acknowledged) return;
+        synced = true;
+        acknowledged = ack;
+        // ack 0: the server hasn't run any of our inputs yet, all of them get replayed
+        bool replayable = ack <= newest && newest - ack < PREDICTION_HISTORY;
+        if (replayable && ack != 0) {
+            const PredictedState& predicted = states[slot(ack)];
+            float error = Vector3Distance(predicted.position, server.position);
+            checked++;
+            errorSum += error;
+            worstError = fmaxf(worstError, error);
+            if (error <= PREDICTION_POSITION_TOLERANCE && Vector3Distance(predicted.speed, server.speed) <= PREDICTION_SPEED_TOLERANCE &&
+                predicted.resting == (bool)server.resting) return;
+        }
+        corrections++;
+
+        Vector3 shown = body.position + errorOffset;
+        body.position = nextPos = server.position;
+        speed = server.speed;
+        body.isResting = server.resting;
+        body.contact = {};  // Forces a full vertical pass, the cached contact belonged to the mispredicted state
+        if (replayable) {
+            for (uint32_t sequence = ack + 1; sequence <= newest && sequence != 0; sequence++) {
+                SimulatePlayer(world, body, nextPos, speed, inputs[slot(sequence)], dt);
+                states[slot(sequence)] = {body.position, speed, body.isResting};
+                replayed++;
+            }
+        }
+        errorOffset = shown - body.position;
+        if (Vector3Length(errorOffset) > PREDICTION_SNAP_DISTANCE) errorOffset = {0.0f, 0.0f, 0.0f};
+    }
+
+    // Blends the visual error out, call once per rendered frame
+    void smooth(float frameDt) {
+        errorOffset = errorOffset * expf(-PREDICTION_SMOOTHING_RATE * frameDt);
+        if (Vector3Length(errorOffset) < 1e-3f) errorOffset = {0.0f, 0.0f, 0.0f};
+    }
+
+    Vector3 shownPosition(const Player& body) const { return body.position + errorOffset; }
+};
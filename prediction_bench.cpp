@@ -0,0 +1,112 @@
+// Client prediction and reconciliation over a simulated link
+//
+// Runs a GameServer and one predicting client in one process, with a LinkRelay between them adding latency, jitter
+// and loss each way. Time is simulated, one 120 Hz tick per iteration, so runs are repeatable and quick. The client
+// walks and jumps around the level on a script. Reports how often the prediction missed and by how much, how far
+// behind the server's acknowledgement runs (the input latency there would be without prediction), the largest
+// visual correction left for smoothing and what the replays cost. Headless.
+// Options:
+//     --latency MS      one way latency, runs only this case together with --jitter and --loss
+//     --jitter MS       extra random one way delay (default 0)
+//     --loss F          fraction of packets lost each way (default 0)
+//     --seconds N       simulated time per case (default 30)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "game_server.h"
+#include "game_client.h"
+#include "prediction.h"
+#include "sim_link.h"
+
+int main(int argc, char** argv) {
+    std::vector<LinkSettings> cases = {{0.0, 0.0, 0.0}, {25.0, 5.0, 0.01}, {50.0, 20.0, 0.05}, {100.0, 40.0, 0.10}};
+    LinkSettings custom;
+    bool single = false;
+    double seconds = 30.0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--latency") == 0) { custom.latencyMs = atof(argv[i + 1]); single = true; }
+        else if (strcmp(argv[i], "--jitter") == 0) custom.jitterMs = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--loss") == 0) custom.loss = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--seconds") == 0) seconds = std::max(1.0, atof(argv[i + 1]));
+    }
+    if (single) cases = {custom};
+
+    const long long tickNs = 1'000'000'000LL / SERVER_TICK_RATE;
+    const int ticks = (int)(seconds * SERVER_TICK_RATE);
+    for (const LinkSettings& link : cases) {
+        GameServer server(99);
+        LinkRelay relay(link, link);
+        GameClient client;
+        if (!server.listen(0, true) || !relay.open({0x7f000001u, server.socket.localPort()}) || !client.open(relay.address(), true)) {
+            fprintf(stderr, "Can't open the loopback sockets\n");
+            return 1;
+        }
+
+        // Client side copy of the level
+        Level level = GenerateLevel(server.seed, server.groundSize);
+        Player player(level.spawn, PLAYER_DIMENSIONS);
+        World world(level.colliders, player);
+        world.terrain = &level.hills;
+        Vector3 nextPos = player.position, speed = {0.0f, 0.0f, 0.0f};
+        Prediction prediction;
+
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+        float heading = angle(rng);
+        long long now = 0;
+        long long lagSum = 0, lagSamples = 0;
+        float worstOffset = 0.0f;
+        double reconcileMs = 0.0;
+        int helloTicks = 0;
+        for (int tick = 0; tick < ticks; tick++) {
+            now += tickNs;
+            relay.pump(now);
+            server.receive();
+            server.tick();
+            relay.pump(now);
+
+            if (client.poll()) {
+                if (const EntityState* self = client.self()) {
+                    auto start = std::chrono::steady_clock::now();
+                    prediction.reconcile(world, player, nextPos, speed, *self, client.acknowledged, SERVER_TICK_DT);
+                    reconcileMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    lagSum += prediction.newest - client.acknowledged;
+                    lagSamples++;
+                }
+            }
+            if (!client.welcomed) {
+                if (helloTicks++ % (SERVER_TICK_RATE / 10) == 0) client.sendHello();
+                continue;
+            }
+
+            // Wander: turn now and then, stop sometimes, jump every so often
+            if (rng() % 90 == 0) heading = angle(rng);
+            bool walking = tick % 600 < 500;
+            if (player.position.x * player.position.x + player.position.z * player.position.z > 12.0f * 12.0f) {
+                heading = atan2f(-player.position.z, -player.position.x);   // Head back to the middle of the ground
+            }
+            float run = walking ? PLAYER_RUN_SPEED : 0.0f;
+            PlayerInput input = client.sendInput(cosf(heading) * run, sinf(heading) * run, rng() % 100 == 0);
+            prediction.predict(world, player, nextPos, speed, input, SERVER_TICK_DT);
+            prediction.smooth(SERVER_TICK_DT);
+            worstOffset = std::max(worstOffset, Vector3Length(prediction.errorOffset));
+        }
+
+        printf("latency %3.0f ms, jitter %3.0f ms, loss %4.1f%%: %lld checks, %lld corrected (%.1f%%), error %.4f average %.3f worst, "
+               "ack %.1f ms behind, largest smoothed offset %.3f, %lld inputs replayed, %.1f us per reconcile\n",
+            link.latencyMs, link.jitterMs, link.loss * 100.0, prediction.checked, prediction.corrections,
+            prediction.checked ? 100.0 * (double)prediction.corrections / (double)prediction.checked : 0.0,
+            prediction.checked ? prediction.errorSum / (double)prediction.checked : 0.0, prediction.worstError,
+            lagSamples ? (double)lagSum / (double)lagSamples * 1000.0 / SERVER_TICK_RATE : 0.0, worstOffset,
+            prediction.replayed, lagSamples ? reconcileMs * 1000.0 / (double)lagSamples : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Benchmark for batched line of sight queries (SceneQuery::lineOfSightBatch against one lineOfSight() per ray)
+//
+// NPCs scattered over generated pillar levels check whether they can see the player, each casting a few rays at
+// points on the player's box like AI perception would. Reports rays and ray-box tests per second on one core and
+// checks the packet results against the single ray ones. Headless, doesn't need a window or GPU.
+// Options:
+//     --sizes 16,1000,...   collider counts to test (default 16,1000,100000; 16 is the level main() generates)
+//     --rays N              rays per level (default 1000000)
+//     --threads N           threads for an extra multi threaded run (default 0, skipped)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "world.h"
+#include "collider_merge.h"
+#include "scene_query.h"
+
+// Same kind of level as main(): a ground plane with random 1x10x1 pillars at the same density, merged the same way
+std::vector<Collider> GenerateLevel(int count)
+{
+    std::mt19937 rng(1234);
+    float half = sqrtf((float)count * 60.0f) * 0.5f;
+    std::uniform_real_distribution<float> spread(-half, half);
+    std::vector<Collider> colliders;
+    colliders.reserve(count);
+    colliders.push_back(Collider({0.0f, 0.475f, 0.0f}, {half * 2.0f, 0.05f, half * 2.0f}));
+    for (int i = 1; i < count; i++) {
+        Collider collider({spread(rng), 0.5f, spread(rng)}, {1.0f, 10.0f, 1.0f});
+        collider.color = RED;
+        colliders.push_back(collider);
+    }
+    return MergeColliders(colliders).colliders;
+}
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes = {16, 1000, 100000};
+    int rays = 1000000;
+    int threads = 0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--sizes") == 0) {
+            sizes.clear();
+            for (char* token = strtok(argv[i + 1], ","); token; token = strtok(nullptr, ",")) sizes.push_back(atoi(token));
+        } else if (strcmp(argv[i], "--rays") == 0) {
+            rays = std::max(1, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = atoi(argv[i + 1]);
+        }
+    }
+
+    printf("packet width %d\n", Lanes::WIDTH);
+    printf("%-10s %-8s %12s %12s %14s %14s %10s %10s\n",
+        "colliders", "npcs", "single ms", "packet ms", "single rays/s", "packet rays/s", "tests/s", "fallback");
+
+    for (int count : sizes) {
+        std::vector<Collider> colliders = GenerateLevel(count);
+        Player player({0.0f, 1.0f, 0.0f}, {0.5f, 1.0f, 0.5f});
+        World world(colliders, player);
+        SceneQuery query(world);
+        float half = colliders[0].dimensions.x * 0.5f;
+
+        // Each NPC looks at the corners of the player's box from eye height, within 30 units
+        std::mt19937 rng(99);
+        std::uniform_real_distribution<float> offset(-std::min(half, 30.0f), std::min(half, 30.0f));
+        std::vector<SightQuery> queries;
+        queries.reserve(rays);
+        int npcs = 0;
+        while ((int)queries.size() < rays) {
+            Vector3 eye = {player.position.x + offset(rng), 1.7f, player.position.z + offset(rng)};
+            npcs++;
+            for (int corner = 0; corner < 8 && (int)queries.size() < rays; corner++) {
+                Vector3 target = {
+                    player.position.x + ((corner & 1) ? 0.24f : -0.24f) * player.dimensions.x,
+                    player.position.y + ((corner & 2) ? 0.49f : -0.49f) * player.dimensions.y,
+                    player.position.z + ((corner & 4) ? 0.24f : -0.24f) * player.dimensions.z,
+                };
+                queries.push_back({eye, target});
+            }
+        }
+
+        std::vector<unsigned char> single(queries.size());
+        auto singleStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < queries.size(); i++) single[i] = query.lineOfSight(queries[i].from, queries[i].to);
+        double singleMs = MsSince(singleStart);
+
+        std::vector<unsigned char> packet;
+        PacketStats stats;
+        auto packetStart = std::chrono::steady_clock::now();
+        query.lineOfSightBatch(queries, packet, 1, &stats);
+        double packetMs = MsSince(packetStart);
+
+        int mismatches = 0;
+        for (size_t i = 0; i < queries.size(); i++) if (single[i] != packet[i]) mismatches++;
+
+        printf("%-10d %-8d %12.2f %12.2f %14.0f %14.0f %10.3gM %9.1f%%\n",
+            (int)colliders.size(), npcs, singleMs, packetMs,
+            queries.size() / (singleMs / 1000.0), queries.size() / (packetMs / 1000.0),
+            stats.rayBoxTests / (packetMs / 1000.0) / 1e6,
+            100.0 * stats.singleRays / std::max(1.0, (double)queries.size()));
+        if (mismatches) printf("  %d results differ from lineOfSight()\n", mismatches);
+
+        if (threads > 0) {
+            auto threadedStart = std::chrono::steady_clock::now();
+            query.lineOfSightBatch(queries, packet, threads);
+            printf("  %d threads: %.2f ms\n", threads, MsSince(threadedStart));
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Offscreen benchmark for Renderer::Draw
+//
+// Renders fixed camera views of generated pillar levels (1k to 1M colliders) into a RenderTexture and reports
+// CPU submit time of Renderer::Draw, rlgl batch flushes per frame and total frame time.
+// Works without a GPU: on a headless Linux box run it on a virtual display with Mesa's software rasterizer, e.g.
+//     LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a -s "-screen 0 1280x720x24" ./render_bench
+// Options:
+//     --sizes 1000,10000,...   collider counts to test (default 1000,10000,100000,1000000)
+//     --frames N               measured frames per view (default 20)
+//     --images DIR             write each view as DIR/render_<count>_<view>.png for visual diffing
+
+#include <raylib.h>
+#include <raymath.h>
+#include <rlgl.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "world.h"
+#include "renderer.h"
+
+constexpr int BENCH_WIDTH = 1280;
+constexpr int BENCH_HEIGHT = 720;
+
+struct View {
+    const char* name;
+    Camera camera;
+};
+
+struct Result {
+    double submitMs = 0.0;
+    double frameMs = 0.0;
+    double minSubmitMs = 1e30;
+    double minFrameMs = 1e30;
+    long long flushes = 0;
+};
+
+// Same kind of level as main(): a ground plane with random 1x10x1 pillars, scaled so density stays the same
+std::vector<Collider> GenerateLevel(int count)
+{
+    std::mt19937 rng(1234);
+    float half = sqrtf((float)count) * 2.0f;
+    std::uniform_real_distribution<float> spread(-half, half);
+    std::vector<Collider> colliders;
+    colliders.reserve(count);
+    colliders.push_back(Collider({0.0f, 0.475f, 0.0f}, {half * 2.0f, 0.05f, half * 2.0f}));
+    for (int i = 1; i < count; i++) {
+        Collider collider({spread(rng), 0.5f, spread(rng)}, {1.0f, 10.0f, 1.0f});
+        collider.color = RED;
+        colliders.push_back(collider);
+    }
+    return colliders;
+}
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes = {1000, 10000, 100000, 1000000};
+    int frames = 20;
+    const char* imageDir = nullptr;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--sizes") == 0) {
+            sizes.clear();
+            for (char* token = strtok(argv[i + 1], ","); token; token = strtok(nullptr, ",")) sizes.push_back(atoi(token));
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            frames = std::max(1, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--images") == 0) {
+            imageDir = argv[i + 1];
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(BENCH_WIDTH, BENCH_HEIGHT, "Renderer benchmark");
+    SetTargetFPS(0);
+    RenderTexture2D target = LoadRenderTexture(BENCH_WIDTH, BENCH_HEIGHT);
+
+    // Our own batch, set up like rlgl's default one, so flushes can be observed: every flush resets
+    // currentDepth to -1 and every rlEnd() moves it forward
+    rlRenderBatch batch = rlLoadRenderBatch(1, RL_DEFAULT_BATCH_BUFFER_ELEMENTS);
+
+    printf("%-10s %-10s %12s %12s %12s %12s %10s\n",
+        "colliders", "view", "submit ms", "min submit", "frame ms", "min frame", "flushes");
+
+    for (int count : sizes) {
+        std::vector<Collider> colliders = GenerateLevel(count);
+        Player player({0.0f, 1.0f, 0.0f}, {0.5f, 1.0f, 0.5f});
+        World world(colliders, player);
+        Renderer renderer(world);
+        float levelSize = colliders[0].dimensions.x;
+
+        // The game's isometric follow camera, and the whole level from above at the same angle
+        View views[2] = {
+            {"game", {{11.0f, 11.0f, 11.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, 15.0f, CAMERA_ORTHOGRAPHIC}},
+            {"overview", {{levelSize, levelSize, levelSize}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, levelSize * 1.2f, CAMERA_ORTHOGRAPHIC}},
+        };
+
+        for (const View& view : views) {
+            Result result;
+            // Two warm up frames
+            for (int frame = -2; frame < frames; frame++) {
+                auto frameStart = std::chrono::steady_clock::now();
+                rlSetRenderBatchActive(&batch);
+                BeginTextureMode(target);
+                ClearBackground(RAYWHITE);
+                BeginMode3D(view.camera);
+
+                long long flushes = 0;
+                float lastDepth = batch.currentDepth;
+                auto submitStart = std::chrono::steady_clock::now();
+                renderer.Draw([&] {
+                    if (batch.currentDepth < lastDepth) flushes++;
+                    lastDepth = batch.currentDepth;
+                });
+                double submitMs = MsSince(submitStart);
+
+                EndMode3D();
+                EndTextureMode();
+                // EndTextureMode() flushed whatever was left
+                flushes++;
+                rlSetRenderBatchActive(nullptr);
+
+                // Present the result so the frame actually has to finish on the (software) GPU
+                BeginDrawing();
+                DrawTextureRec(target.texture, {0.0f, 0.0f, (float)BENCH_WIDTH, -(float)BENCH_HEIGHT}, {0.0f, 0.0f}, WHITE);
+                EndDrawing();
+                double frameMs = MsSince(frameStart);
+
+                if (frame < 0) continue;
+                result.submitMs += submitMs;
+                result.frameMs += frameMs;
+                result.minSubmitMs = std::min(result.minSubmitMs, submitMs);
+                result.minFrameMs = std::min(result.minFrameMs, frameMs);
+                result.flushes = flushes;
+            }
+
+            printf("%-10d %-10s %12.3f %12.3f %12.3f %12.3f %10lld\n",
+                count, view.name,
+                result.submitMs / frames, result.minSubmitMs,
+                result.frameMs / frames, result.minFrameMs,
+                result.flushes);
+            fflush(stdout);
+
+            if (imageDir) {
+                Image image = LoadImageFromTexture(target.texture);
+                ImageFlipVertical(&image);
+                std::string path = std::string(imageDir) + "/render_" + std::to_string(count) + "_" + view.name + ".png";
+                ExportImage(image, path.c_str());
+                UnloadImage(image);
+            }
+        }
+    }
+
+    rlUnloadRenderBatch(batch);
+    UnloadRenderTexture(target);
+    CloseWindow();
+    return 0;
+}
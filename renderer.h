@@ -0,0 +1,140 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <vector>
+
+#include "world.h"
+
+// Terrain gets uploaded as square meshes of this many cells a side (keeps indices within 16 bits)
+constexpr int TERRAIN_CHUNK_CELLS = 64;
+
+struct Renderer {
+    const World& world;
+    // Terrain meshes, built once since the heights don't change
+    std::vector<Model> terrainChunks;
+    Renderer(const World& world): world(world) {
+        if (world.terrain) BuildTerrain(*world.terrain);
+    };
+    // Frees the GPU side, call before CloseWindow() takes the GL context with it
+    void unload() {
+        for (Model& chunk : terrainChunks) UnloadModel(chunk);
+        terrainChunks.clear();
+    }
+    ~Renderer() { unload(); }
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    void BuildTerrain(const Heightfield& terrain) {
+        const Vector3 light = Vector3Normalize({0.4f, 1.0f, 0.2f});
+        for (int chunkZ = 0; chunkZ < terrain.cellsZ; chunkZ += TERRAIN_CHUNK_CELLS) {
+            for (int chunkX = 0; chunkX < terrain.cellsX; chunkX += TERRAIN_CHUNK_CELLS) {
+                int cellsX = std::min(TERRAIN_CHUNK_CELLS, terrain.cellsX - chunkX);
+                int cellsZ = std::min(TERRAIN_CHUNK_CELLS, terrain.cellsZ - chunkZ);
+
+                Mesh mesh = {0};
+                mesh.vertexCount = (cellsX + 1) * (cellsZ + 1);
+                mesh.triangleCount = cellsX * cellsZ * 2;
+                mesh.vertices = (float*)MemAlloc(mesh.vertexCount * 3 * sizeof(float));
+                mesh.normals = (float*)MemAlloc(mesh.vertexCount * 3 * sizeof(float));
+                mesh.colors = (unsigned char*)MemAlloc(mesh.vertexCount * 4);
+                mesh.indices = (unsigned short*)MemAlloc(mesh.triangleCount * 3 * sizeof(unsigned short));
+
+                int v = 0;
+                for (int z = 0; z <= cellsZ; z++) {
+                    for (int x = 0; x <= cellsX; x++, v++) {
+                        int ix = chunkX + x;
+                        int iz = chunkZ + z;
+                        mesh.vertices[v * 3 + 0] = terrain.originX + (float)ix * terrain.cellSize;
+                        mesh.vertices[v * 3 + 1] = terrain.at(ix, iz);
+                        mesh.vertices[v * 3 + 2] = terrain.originZ + (float)iz * terrain.cellSize;
+                        // Normal from central differences, clamped at the terrain edges
+                        float dx = terrain.at(std::min(ix + 1, terrain.cellsX), iz) - terrain.at(std::max(ix - 1, 0), iz);
+                        float dz = terrain.at(ix, std::min(iz + 1, terrain.cellsZ)) - terrain.at(ix, std::max(iz - 1, 0));
+                        Vector3 normal = Vector3Normalize({-dx, 2.0f * terrain.cellSize, -dz});
+                        mesh.normals[v * 3 + 0] = normal.x;
+                        mesh.normals[v * 3 + 1] = normal.y;
+                        mesh.normals[v * 3 + 2] = normal.z;
+                        // No lighting in the default shader, so bake a simple one into the vertex colors
+                        float shade = 0.55f + 0.45f * std::max(0.0f, Vector3DotProduct(normal, light));
+                        mesh.colors[v * 4 + 0] = (unsigned char)(DARKGREEN.r * shade);
+                        mesh.colors[v * 4 + 1] = (unsigned char)(DARKGREEN.g * shade);
+                        mesh.colors[v * 4 + 2] = (unsigned char)(DARKGREEN.b * shade);
+                        mesh.colors[v * 4 + 3] = 255;
+                    }
+                }
+
+                int i = 0;
+                for (int z = 0; z < cellsZ; z++) {
+                    for (int x = 0; x < cellsX; x++) {
+                        unsigned short a = (unsigned short)(z * (cellsX + 1) + x);
+                        unsigned short b = (unsigned short)(a + 1);
+                        unsigned short c = (unsigned short)(a + cellsX + 1);
+                        unsigned short d = (unsigned short)(c + 1);
+                        // Counter clockwise seen from above
+                        mesh.indices[i++] = a; mesh.indices[i++] = c; mesh.indices[i++] = b;
+                        mesh.indices[i++] = b; mesh.indices[i++] = c; mesh.indices[i++] = d;
+                    }
+                }
+
+                UploadMesh(&mesh, false);
+                terrainChunks.push_back(LoadModelFromMesh(mesh));
+            }
+        }
+    }
+
+    void Draw() const {
+        Draw([] {});
+    }
+
+    // Same, calling afterEach() once every box has been submitted (the render benchmark uses it to watch rlgl's batch)
+    template<typename AfterEach>
+    void Draw(AfterEach&& afterEach) const {
+
+        for (const Model& chunk : terrainChunks) {
+            DrawModel(chunk, {0.0f, 0.0f, 0.0f}, 1.0f, WHITE);
+        }
+
+        for (Collider collider : world.colliders) {
+            DrawCube(collider.position,
+                collider.dimensions.x,
+                collider.dimensions.y,
+                collider.dimensions.z,
+                collider.color);
+            DrawCubeWires(collider.position,
+                collider.dimensions.x,
+                collider.dimensions.y,
+                collider.dimensions.z,
+                BLACK);
+            afterEach();
+        }
+
+        for (const Actor& actor : world.actors) {
+            DrawCube(actor.body.position,
+                actor.body.dimensions.x,
+                actor.body.dimensions.y,
+                actor.body.dimensions.z,
+                actor.body.color);
+            DrawCubeWires(actor.body.position,
+                actor.body.dimensions.x,
+                actor.body.dimensions.y,
+                actor.body.dimensions.z,
+                BLACK);
+            afterEach();
+        }
+
+        DrawCube(world.player.position,
+            world.player.dimensions.x,
+            world.player.dimensions.y,
+            world.player.dimensions.z,
+            world.player.color);
+        DrawCubeWires(world.player.position,
+            world.player.dimensions.x,
+            world.player.dimensions.y,
+            world.player.dimensions.z,
+            BLACK);
+        afterEach();
+
+    };
+};
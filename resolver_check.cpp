@@ -0,0 +1,223 @@
+// Check for the axis templated collision resolver
+//
+// Keeps the three hand written resolvers World::resolve<Axis> replaced (resolveX, resolveY and resolveZ as they were,
+// on a bare collider list) and runs them next to World::stepBody() over random scenes: piles of boxes of all sizes
+// with a body thrown in at random, walking, jumping and falling for a few hundred steps. Position, next position,
+// speed and resting have to match bit for bit after every step. No terrain, the old resolvers knew nothing of it.
+// The cached ground contact is cleared before every step so the full pass always runs; a third body keeps it and has
+// to end every step exactly where the full pass does. Exits with 1 on the first difference of either. Headless.
+// Options:
+//     --scenes N        random scenes (default 2000)
+//     --steps N         steps per scene (default 300)
+//     --seed N          (default 1)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "world.h"
+
+constexpr float STEP_DT = 1.0f / 120.0f;
+
+// The resolvers as they were before World::resolve<Axis>, comments trimmed
+struct LegacyResolver {
+    std::vector<Collider>& colliders;
+    Player& player;
+
+    void resolveX(Vector3& nextPos, Vector3& speed) {
+        Vector3 maxPlayerPos = player.position + player.dimensions * 0.5f;
+        Vector3 minPlayerPos = player.position - player.dimensions * 0.5f;
+        Vector3 nextMaxPlayerPos = nextPos + player.dimensions * 0.5f;
+        Vector3 nextMinPlayerPos = nextPos - player.dimensions * 0.5f;
+        for (const Collider& collider : colliders) {
+            Vector3 maxColliderPos = collider.position + collider.dimensions * 0.5f;
+            Vector3 minColliderPos = collider.position - collider.dimensions * 0.5f;
+            if (nextMaxPlayerPos.y > minColliderPos.y &&
+                nextMinPlayerPos.y < maxColliderPos.y &&
+                nextMaxPlayerPos.z > minColliderPos.z &&
+                nextMinPlayerPos.z < maxColliderPos.z) {
+                if (maxPlayerPos.x <= minColliderPos.x &&
+                    nextMaxPlayerPos.x > minColliderPos.x) {
+                    nextPos.x = minColliderPos.x - player.dimensions.x * 0.5f;
+                    speed.x = 0.0f;
+                } else if (minPlayerPos.x >= maxColliderPos.x &&
+                    nextMinPlayerPos.x < maxColliderPos.x) {
+                    nextPos.x = maxColliderPos.x + player.dimensions.x * 0.5f;
+                    speed.x = 0.0f;
+                }
+            }
+        }
+        player.position.x = nextPos.x;
+    }
+
+    void resolveZ(Vector3& nextPos, Vector3& speed) {
+        Vector3 maxPlayerPos = player.position + player.dimensions * 0.5f;
+        Vector3 minPlayerPos = player.position - player.dimensions * 0.5f;
+        Vector3 nextMaxPlayerPos = nextPos + player.dimensions * 0.5f;
+        Vector3 nextMinPlayerPos = nextPos - player.dimensions * 0.5f;
+        for (const Collider& collider : colliders) {
+            Vector3 maxColliderPos = collider.position + collider.dimensions * 0.5f;
+            Vector3 minColliderPos = collider.position - collider.dimensions * 0.5f;
+            if (nextMaxPlayerPos.y > minColliderPos.y &&
+                nextMinPlayerPos.y < maxColliderPos.y &&
+                nextMaxPlayerPos.x > minColliderPos.x &&
+                nextMinPlayerPos.x < maxColliderPos.x) {
+                if (speed.z < 0.0f &&
+                    minPlayerPos.z >= maxColliderPos.z &&
+                    nextMinPlayerPos.z < maxColliderPos.z) {
+                    speed.z = 0.0f;
+                    nextPos.z = maxColliderPos.z + player.dimensions.z * 0.5f;
+                } else if (speed.z > 0 &&
+                    maxPlayerPos.z <= minColliderPos.z &&
+                    nextMaxPlayerPos.z > minColliderPos.z) {
+                    speed.z = 0.0f;
+                    nextPos.z = minColliderPos.z - player.dimensions.z * 0.5f;
+                }
+            }
+        }
+        player.position.z = nextPos.z;
+    }
+
+    void resolveY(Vector3& nextPos, Vector3& speed) {
+        Vector3 maxPlayerPos = player.position + player.dimensions * 0.5f;
+        Vector3 minPlayerPos = player.position - player.dimensions * 0.5f;
+        Vector3 nextMaxPlayerPos = nextPos + player.dimensions * 0.5f;
+        Vector3 nextMinPlayerPos = nextPos - player.dimensions * 0.5f;
+        for (const Collider& collider : colliders) {
+            Vector3 maxColliderPos = collider.position + collider.dimensions * 0.5f;
+            Vector3 minColliderPos = collider.position - collider.dimensions * 0.5f;
+            if (maxPlayerPos.x > minColliderPos.x &&
+                minPlayerPos.x < maxColliderPos.x &&
+                maxPlayerPos.z > minColliderPos.z &&
+                minPlayerPos.z < maxColliderPos.z &&
+                nextMaxPlayerPos.y > minColliderPos.y &&
+                nextMinPlayerPos.y < maxColliderPos.y) {
+                const float EPS = 0.001f;
+                if (maxPlayerPos.y <= minColliderPos.y &&
+                    nextMaxPlayerPos.y > minColliderPos.y) {
+                    speed.y = 0.0f;
+                    nextPos.y = minColliderPos.y - player.dimensions.y * 0.5f;
+                } else if (minPlayerPos.y >= maxColliderPos.y - EPS &&
+                    nextMinPlayerPos.y < maxColliderPos.y) {
+                    speed.y = 0;
+                    nextPos.y = maxColliderPos.y + player.dimensions.y * 0.5f;
+                    player.isResting = true;
+                }
+            }
+        }
+        player.position.y = nextPos.y;
+    }
+
+    // The movement order main.cpp used around them
+    void step(Vector3& nextPos, Vector3& speed, float dt) {
+        player.isResting = false;
+        nextPos.x = player.position.x + speed.x * dt;
+        resolveX(nextPos, speed);
+        nextPos.z = player.position.z + speed.z * dt;
+        resolveZ(nextPos, speed);
+        speed.y -= GRAVITY_PULL * dt;
+        nextPos.y = player.position.y + speed.y * dt;
+        resolveY(nextPos, speed);
+    }
+};
+
+bool Same(const Vector3& a, const Vector3& b)
+{
+    return memcmp(&a, &b, sizeof(Vector3)) == 0;
+}
+
+int main(int argc, char** argv) {
+    int scenes = 2000;
+    int steps = 300;
+    unsigned seed = 1;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--scenes") == 0) scenes = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--steps") == 0) steps = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--seed") == 0) seed = (unsigned)strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto range = [&](float lo, float hi) { return lo + (hi - lo) * unit(rng); };
+    long long compared = 0, landings = 0, blocked = 0;
+    for (int scene = 0; scene < scenes; scene++) {
+        // A floor, then boxes from thin walls to big platforms, some touching, some stacked
+        std::vector<Collider> colliders = {Collider({0.0f, 0.0f, 0.0f}, {range(10.0f, 40.0f), 1.0f, range(10.0f, 40.0f)})};
+        int boxes = (int)range(0.0f, 40.0f);
+        for (int b = 0; b < boxes; b++) {
+            colliders.emplace_back(Vector3{range(-8.0f, 8.0f), range(0.0f, 4.0f), range(-8.0f, 8.0f)},
+                Vector3{range(0.1f, 4.0f), range(0.1f, 3.0f), range(0.1f, 4.0f)});
+        }
+        // Every third scene also has plates whose tops are within a step's fall or the landing epsilon of the floor's,
+        // where a body resting on one gets lifted onto or dropped to the next
+        if (scene % 3 == 0) {
+            int plates = (int)range(5.0f, 30.0f);
+            for (int b = 0; b < plates; b++) {
+                float height = range(0.1f, 1.0f);
+                float top = 0.5f + range(-0.002f, 0.002f);
+                colliders.emplace_back(Vector3{range(-8.0f, 8.0f), top - height * 0.5f, range(-8.0f, 8.0f)},
+                    Vector3{range(0.5f, 4.0f), height, range(0.5f, 4.0f)});
+            }
+        }
+        Vector3 start = {range(-6.0f, 6.0f), range(1.0f, 8.0f), range(-6.0f, 6.0f)};
+        Vector3 dims = {range(0.2f, 1.0f), range(0.5f, 2.0f), range(0.2f, 1.0f)};
+        Player oldBody(start, dims), newBody(start, dims), cachedBody(start, dims);
+        LegacyResolver legacy{colliders, oldBody};
+        World world(colliders, newBody);
+        Vector3 oldNext = start, newNext = start, cachedNext = start;
+        Vector3 oldSpeed = {0.0f, 0.0f, 0.0f}, newSpeed = {0.0f, 0.0f, 0.0f}, cachedSpeed = newSpeed;
+
+        for (int step = 0; step < steps; step++) {
+            // Walk in a new direction now and then, sometimes at speeds that cross a thin box in one step
+            if (step % 40 == 0) {
+                float fast = unit(rng) < 0.2f ? 60.0f : 10.0f;
+                oldSpeed.x = newSpeed.x = range(-fast, fast);
+                oldSpeed.z = newSpeed.z = range(-fast, fast);
+            }
+            if (newBody.isResting && unit(rng) < 0.05f) oldSpeed.y = newSpeed.y = range(3.0f, 9.0f);
+            // Starts from the full pass's state but with its own contact cache
+            GroundContact contact = cachedBody.contact;
+            cachedBody = newBody;
+            cachedBody.contact = contact;
+            cachedNext = newNext;
+            cachedSpeed = newSpeed;
+            legacy.step(oldNext, oldSpeed, STEP_DT);
+            newBody.contact = {};
+            world.stepBody(newBody, newNext, newSpeed, STEP_DT);
+            world.stepBody(cachedBody, cachedNext, cachedSpeed, STEP_DT);
+            if (!Same(cachedBody.position, newBody.position) || !Same(cachedSpeed, newSpeed) ||
+                cachedBody.isResting != newBody.isResting) {
+                printf("Ground contact shortcut differs in scene %d step %d: position (%.9g %.9g %.9g) vs (%.9g %.9g %.9g)\n",
+                    scene, step, cachedBody.position.x, cachedBody.position.y, cachedBody.position.z,
+                    newBody.position.x, newBody.position.y, newBody.position.z);
+                return 1;
+            }
+            compared++;
+            landings += newBody.isResting;
+            blocked += newSpeed.x == 0.0f || newSpeed.z == 0.0f;
+            if (!Same(oldBody.position, newBody.position) || !Same(oldNext, newNext) || !Same(oldSpeed, newSpeed) ||
+                oldBody.isResting != newBody.isResting) {
+                printf("Mismatch in scene %d step %d: position (%.9g %.9g %.9g) vs (%.9g %.9g %.9g), "
+                       "speed (%.9g %.9g %.9g) vs (%.9g %.9g %.9g), resting %d vs %d\n",
+                    scene, step, oldBody.position.x, oldBody.position.y, oldBody.position.z,
+                    newBody.position.x, newBody.position.y, newBody.position.z, oldSpeed.x, oldSpeed.y, oldSpeed.z,
+                    newSpeed.x, newSpeed.y, newSpeed.z, oldBody.isResting, newBody.isResting);
+                return 1;
+            }
+            // Fell off, start over above the boxes
+            if (newBody.position.y < -20.0f) {
+                oldBody.position = newBody.position = oldNext = newNext = start;
+                oldSpeed = newSpeed = {0.0f, 0.0f, 0.0f};
+                cachedBody.contact = {};
+            }
+        }
+    }
+    printf("%d scenes, %lld steps compared, %lld resting and %lld blocked on X or Z: all identical, with the ground "
+           "contact shortcut too\n", scenes, compared, landings, blocked);
+    return 0;
+}
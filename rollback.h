@@ -0,0 +1,148 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "world.h"
+#include "net.h"
+#include "player_controller.h"
+
+struct RollbackSettings {
+    int maxRollback = 8;    // Furthest back a late input can reach. The session waits rather than run further ahead
+                            // of the peer it has heard least from.
+};
+
+struct RollbackInput {
+    uint32_t frame = 0;     // The frame this input is for, 0 if the slot holds nothing
+    PlayerInput input;
+};
+
+// Rollback netcode for peer to peer play, GGPO style. Every peer runs the whole match: each peer plays one actor,
+// driven like the server drives its clients (move through applyInput, jump off the step's resting state), and every
+// frame runs right away on the inputs at hand. A remote input that hasn't arrived yet is guessed to be the last one
+// that did, minus any jump. When the real one turns up and differs from the guess, the world goes back to how it
+// was before that frame and every frame since runs again, all within the same advance(). The world is saved before
+// each frame into a ring of WorldStates, which after the first laps is just memcpys into buffers already there.
+//
+// Everything the frames change has to be in the World: rules passed to advance() get run again on rollback, so
+// they can only go by the world and the frame number. The level's colliders aren't saved and can't change.
+struct RollbackSession {
+    World& world;
+    RollbackSettings settings;
+    std::vector<int> actorOf;               // Actor each peer plays
+    int ringSize;
+    std::vector<WorldState> states;         // World before frame f ran, at f % ringSize
+    std::vector<RollbackInput> received;    // Inputs heard of, at peer * ringSize + f % ringSize
+    std::vector<PlayerInput> used;          // What frame f actually ran with, heard of or guessed, same layout
+    std::vector<uint32_t> confirmed;        // Per peer, the frame up to which every input is in
+    uint32_t frame = 1;                     // The next frame to run, counting from 1
+    uint32_t mispredicted = 0;              // Earliest frame that ran on a wrong guess, 0 if none did
+    // Statistics
+    long long frames = 0, stalls = 0, rollbacks = 0, resimulated = 0;
+    int deepest = 0;
+    double frameMs = 0.0, saveMs = 0.0, rollbackMs = 0.0, worstRollbackMs = 0.0;
+
+    RollbackSession(World& world, const std::vector<int>& peerActors, RollbackSettings settings = {})
+        : world(world), settings(settings), actorOf(peerActors), ringSize(std::max(1, settings.maxRollback) + 2),
+          states(ringSize), received(peerActors.size() * ringSize), used(peerActors.size() * ringSize),
+          confirmed(peerActors.size(), 0) {}
+
+    int peers() const { return (int)actorOf.size(); }
+    int slot(int peer, uint32_t f) const { return peer * ringSize + (int)(f % (uint32_t)ringSize); }
+    uint32_t oldestConfirmed() const { return *std::min_element(confirmed.begin(), confirmed.end()); }
+
+    static bool same(const PlayerInput& a, const PlayerInput& b) {
+        return a.moveX == b.moveX && a.moveZ == b.moveZ && a.jump == b.jump && a.interact == b.interact;
+    }
+
+    // The local peer's input, or a remote one off the wire, in any order. False if it's too far ahead to keep.
+    bool addInput(int peer, uint32_t f, const PlayerInput& input) {
+        if (f == 0 || f <= confirmed[peer]) return true;    // Had it already
+        if (f >= confirmed[peer] + (uint32_t)ringSize) return false;
+        received[slot(peer, f)] = {f, input};
+        if (f < frame && !same(used[slot(peer, f)], input)) {
+            mispredicted = mispredicted == 0 ? f : std::min(mispredicted, f);
+        }
+        while (received[slot(peer, confirmed[peer] + 1)].frame == confirmed[peer] + 1) confirmed[peer]++;
+        return true;
+    }
+
+    // Heard of, or else the last one heard of still held down. A jump is a press, it isn't guessed to repeat.
+    PlayerInput inputFor(int peer, uint32_t f) const {
+        const RollbackInput& known = received[slot(peer, f)];
+        if (known.frame == f) return known.input;
+        const RollbackInput& last = received[slot(peer, confirmed[peer])];
+        if (confirmed[peer] == 0 || last.frame != confirmed[peer]) return {};
+        PlayerInput guess = last.input;
+        guess.jump = 0;
+        guess.interact = 0;
+        return guess;
+    }
+
+    // Runs one frame: rules(world, frame) for everything that isn't a peer, then the peers' inputs and the step
+    template<typename Rules>
+    void run(uint32_t f, float dt, Rules& rules) {
+        rules(world, f);
+        for (int peer = 0; peer < peers(); peer++) {
+            PlayerInput& input = used[slot(peer, f)] = inputFor(peer, f);
+            Vector3 move = {input.moveX, 0.0f, input.moveZ};
+            float length = Vector3Length(move);
+            if (length > PLAYER_RUN_SPEED * 1.001f) move = move * (PLAYER_RUN_SPEED / length);
+            world.applyInput(actorOf[peer], move);
+        }
+        world.step(dt);
+        for (int peer = 0; peer < peers(); peer++) {
+            Actor& actor = world.actors[actorOf[peer]];
+            if (used[slot(peer, f)].jump && actor.body.isResting) {
+                actor.speed.y = PLAYER_JUMP_SPEED;
+                world.wake(actorOf[peer]);
+            }
+        }
+    }
+
+    // Puts the world back to before frame from and runs every frame since again
+    template<typename Rules>
+    void rollback(uint32_t from, float dt, Rules& rules) {
+        if (from == 0 || from >= frame || frame - from > (uint32_t)settings.maxRollback) return;
+        auto start = std::chrono::steady_clock::now();
+        world.restore(states[from % ringSize]);
+        for (uint32_t f = from; f < frame; f++) {
+            if (f != from) world.save(states[f % ringSize]);
+            run(f, dt, rules);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        rollbacks++;
+        resimulated += frame - from;
+        deepest = std::max(deepest, (int)(frame - from));
+        rollbackMs += ms;
+        worstRollbackMs = std::max(worstRollbackMs, ms);
+    }
+
+    // Fixes up whatever ran on wrong guesses, then runs the next frame. False if it had to wait for a peer instead.
+    template<typename Rules>
+    bool advance(float dt, Rules&& rules) {
+        if (mispredicted != 0) {
+            rollback(mispredicted, dt, rules);
+            mispredicted = 0;
+        }
+        if (frame - oldestConfirmed() > (uint32_t)settings.maxRollback) {
+            stalls++;
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        world.save(states[frame % ringSize]);
+        auto saved = std::chrono::steady_clock::now();
+        run(frame, dt, rules);
+        frame++;
+        frames++;
+        saveMs += std::chrono::duration<double, std::milli>(saved - start).count();
+        frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    bool advance(float dt) { return advance(dt, [](World&, uint32_t) {}); }
+};
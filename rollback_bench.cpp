@@ -0,0 +1,196 @@
+// Benchmark for rollback netcode
+//
+// Plays a peer to peer match twice in step: once in a RollbackSession that gets the remote peers' inputs late, by a
+// random number of frames each, and once in one that gets every input on time and so never rolls back. Peer 0 is
+// the local player, the others walk and jump on a random script, and a crowd of NPCs wanders by rules that only look
+// at the frame number, as rollback requires. After every frame the rolled back world, as of the last frame all
+// inputs are in for, is checked against the on time one. Then forces full depth rollbacks to time the worst case
+// against a 60 Hz frame. Reports save, frame and rollback costs. Headless.
+// Options:
+//     --npcs A,B,C      crowd sizes to test (default 100,400,1600)
+//     --peers N         players (default 4)
+//     --delay N         most frames a remote input arrives late (default 6), over --rollback makes the session wait
+//     --rollback N      most frames a rollback reaches back (default 8)
+//     --seconds N       simulated time per crowd size (default 20)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "world.h"
+#include "level.h"
+#include "rollback.h"
+
+constexpr int FRAME_RATE = 60;
+constexpr float FRAME_DT = 1.0f / (float)FRAME_RATE;
+constexpr int FORCED_ROLLBACKS = 200;
+
+// Frame and actor hashed together, the NPCs' only source of randomness
+uint32_t Hash(uint32_t frame, uint32_t index)
+{
+    uint32_t h = frame * 0x9e3779b1u ^ index * 0x85ebca6bu;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+
+// What the next frame does with a world depends on these
+bool SameState(const WorldState& a, const WorldState& b)
+{
+    if (a.actors.size() != b.actors.size() || a.awakeActors != b.awakeActors) return false;
+    for (size_t i = 0; i < a.actors.size(); i++) {
+        const Actor& x = a.actors[i];
+        const Actor& y = b.actors[i];
+        if (memcmp(&x.body.position, &y.body.position, sizeof(Vector3)) != 0 || memcmp(&x.speed, &y.speed, sizeof(Vector3)) != 0 ||
+            memcmp(&x.move, &y.move, sizeof(Vector3)) != 0 || x.body.isResting != y.body.isResting ||
+            x.sleeping != y.sleeping || x.stillSteps != y.stillSteps) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> counts = {100, 400, 1600};
+    int peers = 4;
+    int maxDelay = 6;
+    RollbackSettings settings;
+    double seconds = 20.0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--npcs") == 0) {
+            counts.clear();
+            for (char* p = argv[i + 1]; *p; ) {
+                counts.push_back(std::clamp((int)strtol(p, &p, 10), 0, 100000));
+                if (*p == ',') p++;
+                else break;
+            }
+        } else if (strcmp(argv[i], "--peers") == 0) {
+            peers = std::clamp(atoi(argv[i + 1]), 1, 64);
+        } else if (strcmp(argv[i], "--delay") == 0) {
+            maxDelay = std::clamp(atoi(argv[i + 1]), 0, 1000);
+        } else if (strcmp(argv[i], "--rollback") == 0) {
+            settings.maxRollback = std::clamp(atoi(argv[i + 1]), 1, 1000);
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = std::max(1.0, atof(argv[i + 1]));
+        }
+    }
+
+    const double budgetMs = 1000.0 / FRAME_RATE;
+    for (int npcs : counts) {
+        Level level = GenerateLevel(3, 40.0f);
+        const float half = level.groundDimensions.x * 0.5f - 3.0f;
+        // Two copies of the same match
+        Player parked[2] = {Player({0.0f, -1000.0f, 0.0f}, PLAYER_DIMENSIONS), Player({0.0f, -1000.0f, 0.0f}, PLAYER_DIMENSIONS)};
+        World live(level.colliders, parked[0]), onTime(level.colliders, parked[1]);
+        std::vector<int> peerActors;
+        std::mt19937 rng(9);
+        for (World* world : {&live, &onTime}) {
+            world->terrain = &level.hills;
+            std::mt19937 placement(17);
+            std::uniform_real_distribution<float> place(-half, half);
+            peerActors.clear();
+            for (int p = 0; p < peers; p++) peerActors.push_back(world->addActor({place(placement), 2.0f, place(placement)}, PLAYER_DIMENSIONS));
+            for (int i = 0; i < npcs; i++) world->addActor({place(placement), 2.0f, place(placement)}, {0.5f, 1.0f, 0.5f});
+        }
+        RollbackSession session(live, peerActors, settings), reference(onTime, peerActors, settings);
+        auto rules = [&](World& world, uint32_t frame) {
+            for (int i = peers; i < (int)world.actors.size(); i++) {
+                const Vector3& p = world.actors[i].body.position;
+                if (fabsf(p.x) > half || fabsf(p.z) > half) {
+                    world.applyInput(i, Vector3Normalize({-p.x, 0.0f, -p.z}) * 3.0f);
+                } else if (frame == 1 || Hash(frame, (uint32_t)i) % 180 == 0) {
+                    float a = (float)(Hash(frame, (uint32_t)i + 0x10000u) % 6283u) * 0.001f;
+                    world.applyInput(i, {cosf(a) * 3.0f, 0.0f, sinf(a) * 3.0f});
+                }
+            }
+        };
+
+        struct Late {
+            long long arrives;
+            int peer;
+            uint32_t frame;
+            PlayerInput input;
+        };
+        std::vector<Late> inFlight;
+        std::vector<float> heading(peers, 0.0f);
+        std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+        std::uniform_int_distribution<int> delay(0, maxDelay);
+        uint32_t scripted = 0;      // Last frame the peers' inputs were made up for
+        long long checked = 0, desyncs = 0;
+        const long long ticks = (long long)(seconds * FRAME_RATE);
+        for (long long tick = 0; tick < ticks; tick++) {
+            uint32_t frame = session.frame;
+            if (frame > scripted) {
+                scripted = frame;
+                for (int p = 0; p < peers; p++) {
+                    if (rng() % 90 == 0) heading[p] = angle(rng);
+                    const Vector3& at = onTime.actors[peerActors[p]].body.position;
+                    if (fabsf(at.x) > half || fabsf(at.z) > half) heading[p] = atan2f(-at.z, -at.x);
+                    PlayerInput input = {frame, cosf(heading[p]) * PLAYER_RUN_SPEED, sinf(heading[p]) * PLAYER_RUN_SPEED, (uint8_t)(rng() % 60 == 0)};
+                    reference.addInput(p, frame, input);
+                    if (p == 0) session.addInput(p, frame, input);
+                    else inFlight.push_back({tick + delay(rng), p, frame, input});
+                }
+            }
+            // Whatever arrived by now, in no particular order
+            for (size_t i = 0; i < inFlight.size(); ) {
+                if (inFlight[i].arrives <= tick) {
+                    session.addInput(inFlight[i].peer, inFlight[i].frame, inFlight[i].input);
+                    inFlight[i] = inFlight.back();
+                    inFlight.pop_back();
+                } else {
+                    i++;
+                }
+            }
+            if (!session.advance(FRAME_DT, rules)) continue;
+            reference.advance(FRAME_DT, rules);
+
+            // The world before the first frame someone's input is missing for had every input right
+            uint32_t settled = session.oldestConfirmed() + 1;
+            if (settled > 1 && settled < session.frame) {
+                checked++;
+                desyncs += !SameState(session.states[settled % session.ringSize], reference.states[settled % reference.ringSize]);
+            }
+        }
+        // Everything arrives, the last rollback, and the two must agree on the whole world
+        for (const Late& late : inFlight) session.addInput(late.peer, late.frame, late.input);
+        session.advance(FRAME_DT, rules);
+        reference.advance(FRAME_DT, rules);
+        WorldState liveEnd, onTimeEnd;
+        live.save(liveEnd);
+        onTime.save(onTimeEnd);
+        bool agree = SameState(liveEnd, onTimeEnd);
+
+        // The worst case: every frame a full depth rollback
+        double forcedMs = 0.0, forcedWorstMs = 0.0;
+        int depth = std::min(settings.maxRollback, (int)session.frame - 1);
+        for (int r = 0; r < FORCED_ROLLBACKS; r++) {
+            auto start = std::chrono::steady_clock::now();
+            session.rollback(session.frame - (uint32_t)depth, FRAME_DT, rules);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            forcedMs += ms;
+            forcedWorstMs = std::max(forcedWorstMs, ms);
+        }
+        long long natural = session.rollbacks - FORCED_ROLLBACKS;
+        double naturalMs = session.rollbackMs - forcedMs;
+
+        double frames = (double)std::max(session.frames, 1LL);
+        printf("%d peers, %d NPCs, inputs up to %d frames late: frame %.3f ms (save %.3f ms), %lld rollbacks %.1f frames deep "
+               "on average (%d deepest) costing %.3f ms, %lld stalls\n",
+            peers, npcs, maxDelay, session.frameMs / frames, session.saveMs / frames, natural,
+            natural > 0 ? (double)(session.resimulated - (long long)FORCED_ROLLBACKS * depth) / (double)natural : 0.0,
+            session.deepest, natural > 0 ? naturalMs / (double)natural : 0.0, session.stalls);
+        printf("      %d frame rollback: %.3f ms average, %.3f ms worst, %.0f%% of a %.1f ms frame; "
+               "%lld settled frames checked, %lld desyncs, final worlds %s\n",
+            depth, forcedMs / FORCED_ROLLBACKS, forcedWorstMs, 100.0 * forcedMs / FORCED_ROLLBACKS / budgetMs, budgetMs,
+            checked, desyncs, agree ? "agree" : "DIFFER");
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+#include "world.h"
+#include "parallel.h"
+#include "simd.h"
+
+// Result of a ray or box cast against the colliders
+struct SceneHit {
+    bool hit = false;
+    float distance = 0.0f;
+    Vector3 point = {0.0f, 0.0f, 0.0f};     // For box casts, the box center at the time of impact
+    Vector3 normal = {0.0f, 0.0f, 0.0f};
+    int collider = -1;                      // Index into World::colliders
+};
+
+struct RayQuery {
+    Vector3 origin;
+    Vector3 direction;  // Normalized
+    float maxDistance;
+};
+
+struct BoxCastQuery {
+    Vector3 center;
+    Vector3 halfExtents;
+    Vector3 direction;  // Normalized
+    float maxDistance;
+};
+
+// Segment for batched line of sight checks
+struct SightQuery {
+    Vector3 from;
+    Vector3 to;
+};
+
+// Counters for lineOfSightBatch, for benchmarking
+struct PacketStats {
+    long long packets = 0;
+    long long rayBoxTests = 0;      // Slab tests done in packets, counting only the lanes still being traced
+    long long singleRays = 0;       // Rays finished on their own after their packet diverged
+};
+
+// Bounding volume hierarchy over World::colliders
+struct BvhNode {
+    Vector3 min;
+    Vector3 max;
+    int first;  // Leaf: first entry in SceneQuery::order. Inner node: index of the left child, the right one follows
+    int count;  // Number of colliders in a leaf, 0 for inner nodes
+};
+
+// Ray casts, swept box casts and overlap tests over the colliders of a world, single or batched. Built once from
+// the colliders; call refresh() each frame (cheap) so it rebuilds after World::collidersChanged().
+// Queries are const, so batches can run on several threads.
+struct SceneQuery {
+    static constexpr int LEAF_SIZE = 4;
+
+    const World& world;
+    unsigned generation = 0;
+    std::vector<Vector3> mins;
+    std::vector<Vector3> maxs;
+    std::vector<int> order;
+    std::vector<BvhNode> nodes;
+
+    explicit SceneQuery(const World& world) : world(world) { build(); }
+
+    void refresh() {
+        if (generation != world.colliderGeneration) build();
+    }
+
+    void build() {
+        generation = world.colliderGeneration;
+        const std::vector<Collider>& colliders = world.colliders;
+        int count = (int)colliders.size();
+        mins.resize(count);
+        maxs.resize(count);
+        order.resize(count);
+        for (int i = 0; i < count; i++) {
+            // Same bounds the resolver computes
+            mins[i] = colliders[i].position - colliders[i].dimensions * 0.5f;
+            maxs[i] = colliders[i].position + colliders[i].dimensions * 0.5f;
+            order[i] = i;
+        }
+        nodes.clear();
+        if (count == 0) return;
+        nodes.reserve(2 * count / LEAF_SIZE + 1);
+        nodes.push_back({});
+        buildNode(0, 0, count);
+    }
+
+    void buildNode(int node, int first, int count) {
+        Vector3 lo = mins[order[first]];
+        Vector3 hi = maxs[order[first]];
+        Vector3 centerLo = (mins[order[first]] + maxs[order[first]]) * 0.5f;
+        Vector3 centerHi = centerLo;
+        for (int i = first; i < first + count; i++) {
+            lo = Vector3Min(lo, mins[order[i]]);
+            hi = Vector3Max(hi, maxs[order[i]]);
+            Vector3 center = (mins[order[i]] + maxs[order[i]]) * 0.5f;
+            centerLo = Vector3Min(centerLo, center);
+            centerHi = Vector3Max(centerHi, center);
+        }
+        nodes[node].min = lo;
+        nodes[node].max = hi;
+        if (count <= LEAF_SIZE) {
+            nodes[node].first = first;
+            nodes[node].count = count;
+            return;
+        }
+
+        // Median split along the axis the centers spread the most on
+        Vector3 spread = centerHi - centerLo;
+        int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : spread.y >= spread.z ? 1 : 2;
+        auto key = [&](int i) {
+            Vector3 center = (mins[i] + maxs[i]) * 0.5f;
+            return axis == 0 ? center.x : axis == 1 ? center.y : center.z;
+        };
+        int half = count / 2;
+        std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+            [&](int a, int b) { return key(a) < key(b); });
+
+        int left = (int)nodes.size();
+        nodes.push_back({});
+        nodes.push_back({});
+        nodes[node].first = left;
+        nodes[node].count = 0;
+        buildNode(left, first, half);
+        buildNode(left + 1, first + half, count - half);
+    }
+
+    // Slab test of a ray against a box grown by grow. Returns the entry distance (0 if the ray starts inside),
+    // or -1 if there's no hit within maxDistance. axis gets the axis of the face hit first.
+    static float slab(const Vector3& origin, const Vector3& invDir, const Vector3& lo, const Vector3& hi,
+                      const Vector3& grow, float maxDistance, int& axis) {
+        float tx1 = (lo.x - grow.x - origin.x) * invDir.x, tx2 = (hi.x + grow.x - origin.x) * invDir.x;
+        float ty1 = (lo.y - grow.y - origin.y) * invDir.y, ty2 = (hi.y + grow.y - origin.y) * invDir.y;
+        float tz1 = (lo.z - grow.z - origin.z) * invDir.z, tz2 = (hi.z + grow.z - origin.z) * invDir.z;
+        // std::min/max rather than fminf/fmaxf, those don't compile down to single instructions
+        float nx = std::min(tx1, tx2), ny = std::min(ty1, ty2), nz = std::min(tz1, tz2);
+        float tmin = std::max(std::max(nx, ny), nz);
+        float tmax = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::max(tz1, tz2));
+        if (tmax < 0.0f || tmin > tmax || tmin > maxDistance) return -1.0f;
+        axis = tmin == nx ? 0 : tmin == ny ? 1 : 2;
+        return std::max(tmin, 0.0f);
+    }
+
+    static Vector3 inverse(const Vector3& direction) {
+        // Division by zero gives infinities, which the slab test handles
+        return {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+    }
+
+    // Closest hit of a ray (or a box of halfExtents swept along it), or the first one found when anyHit is set.
+    // root limits the search to a subtree.
+    SceneHit cast(const Vector3& origin, const Vector3& direction, const Vector3& halfExtents, float maxDistance,
+                  bool anyHit, int root = 0) const {
+        SceneHit best;
+        if (nodes.empty()) return best;
+        const Vector3 invDir = inverse(direction);
+        float closest = maxDistance;
+        int stack[64];
+        int top = 0;
+        stack[top++] = root;
+        while (top > 0) {
+            const BvhNode& node = nodes[stack[--top]];
+            int axis;
+            if (slab(origin, invDir, node.min, node.max, halfExtents, closest, axis) < 0.0f) continue;
+            if (node.count == 0) {
+                // Visit the nearer child first so closest can shrink early
+                const BvhNode& left = nodes[node.first];
+                const BvhNode& right = nodes[node.first + 1];
+                float toLeft = Vector3DotProduct((left.min + left.max) * 0.5f - origin, direction);
+                float toRight = Vector3DotProduct((right.min + right.max) * 0.5f - origin, direction);
+                if (toLeft < toRight) {
+                    stack[top++] = node.first + 1;
+                    stack[top++] = node.first;
+                } else {
+                    stack[top++] = node.first;
+                    stack[top++] = node.first + 1;
+                }
+                continue;
+            }
+            for (int i = node.first; i < node.first + node.count; i++) {
+                int collider = order[i];
+                float t = slab(origin, invDir, mins[collider], maxs[collider], halfExtents, closest, axis);
+                if (t < 0.0f || (best.hit && t >= closest)) continue;
+                closest = t;
+                best.hit = true;
+                best.distance = t;
+                best.collider = collider;
+                best.point = origin + direction * t;
+                best.normal = {0.0f, 0.0f, 0.0f};
+                if (t == 0.0f) {
+                    best.normal = Vector3Negate(direction);
+                } else if (axis == 0) {
+                    best.normal.x = direction.x > 0.0f ? -1.0f : 1.0f;
+                } else if (axis == 1) {
+                    best.normal.y = direction.y > 0.0f ? -1.0f : 1.0f;
+                } else {
+                    best.normal.z = direction.z > 0.0f ? -1.0f : 1.0f;
+                }
+                if (anyHit) return best;
+            }
+        }
+        return best;
+    }
+
+    SceneHit raycast(const Vector3& origin, const Vector3& direction, float maxDistance) const {
+        return cast(origin, direction, {0.0f, 0.0f, 0.0f}, maxDistance, false);
+    }
+
+    // Line of sight: true if nothing blocks the segment between from and to
+    bool lineOfSight(const Vector3& from, const Vector3& to) const {
+        Vector3 delta = to - from;
+        float distance = Vector3Length(delta);
+        if (distance <= 0.0f) return true;
+        return !cast(from, delta / distance, {0.0f, 0.0f, 0.0f}, distance, true).hit;
+    }
+
+    SceneHit boxCast(const Vector3& center, const Vector3& halfExtents, const Vector3& direction, float maxDistance) const {
+        return cast(center, direction, halfExtents, maxDistance, false);
+    }
+
+    // Appends every collider overlapping the box [min, max] (touching doesn't count, same as the resolver)
+    void overlap(const Vector3& min, const Vector3& max, std::vector<int>& out) const {
+        if (nodes.empty()) return;
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const BvhNode& node = nodes[stack[--top]];
+            if (!(max.x > node.min.x && min.x < node.max.x &&
+                  max.y > node.min.y && min.y < node.max.y &&
+                  max.z > node.min.z && min.z < node.max.z)) continue;
+            if (node.count == 0) {
+                stack[top++] = node.first;
+                stack[top++] = node.first + 1;
+                continue;
+            }
+            for (int i = node.first; i < node.first + node.count; i++) {
+                int collider = order[i];
+                if (max.x > mins[collider].x && min.x < maxs[collider].x &&
+                    max.y > mins[collider].y && min.y < maxs[collider].y &&
+                    max.z > mins[collider].z && min.z < maxs[collider].z) out.push_back(collider);
+            }
+        }
+    }
+
+    // Up to Lanes::WIDTH rays traced together, one per lane
+    struct RayPacket {
+        Lanes originX, originY, originZ;
+        Lanes invX, invY, invZ;
+        Lanes length;
+    };
+
+    // Lanes whose ray hits the box within its length, same test as slab() without growing the box
+    static int slabPacket(const RayPacket& packet, const Vector3& lo, const Vector3& hi) {
+        Lanes tx1 = (Lanes::set(lo.x) - packet.originX) * packet.invX, tx2 = (Lanes::set(hi.x) - packet.originX) * packet.invX;
+        Lanes ty1 = (Lanes::set(lo.y) - packet.originY) * packet.invY, ty2 = (Lanes::set(hi.y) - packet.originY) * packet.invY;
+        Lanes tz1 = (Lanes::set(lo.z) - packet.originZ) * packet.invZ, tz2 = (Lanes::set(hi.z) - packet.originZ) * packet.invZ;
+        Lanes tmin = Max(Max(Min(tx1, tx2), Min(ty1, ty2)), Min(tz1, tz2));
+        Lanes tmax = Min(Min(Max(tx1, tx2), Max(ty1, ty2)), Max(tz1, tz2));
+        int miss = Less(tmax, Lanes::set(0.0f)) | Greater(tmin, tmax) | Greater(tmin, packet.length);
+        return ~miss & Lanes::ALL;
+    }
+
+    // Line of sight for up to Lanes::WIDTH segments at once, sets visible[i] for each. The packet walks the tree
+    // as long as at least two of its rays still go the same way; once a subtree is only entered by a single ray
+    // that ray finishes it on its own with cast(). Gives exactly the same answers as lineOfSight().
+    void lineOfSightPacket(const SightQuery* queries, int count, unsigned char* visible, PacketStats& stats) const {
+        alignas(64) float values[7][Lanes::WIDTH] = {};
+        Vector3 origins[Lanes::WIDTH];
+        Vector3 directions[Lanes::WIDTH];
+        float lengths[Lanes::WIDTH];
+        int active = 0;
+        for (int lane = 0; lane < count; lane++) {
+            // Same math as lineOfSight()
+            Vector3 delta = queries[lane].to - queries[lane].from;
+            float distance = Vector3Length(delta);
+            visible[lane] = 1;
+            if (distance <= 0.0f || nodes.empty()) continue;
+            origins[lane] = queries[lane].from;
+            directions[lane] = delta / distance;
+            lengths[lane] = distance;
+            Vector3 invDir = inverse(directions[lane]);
+            values[0][lane] = origins[lane].x;
+            values[1][lane] = origins[lane].y;
+            values[2][lane] = origins[lane].z;
+            values[3][lane] = invDir.x;
+            values[4][lane] = invDir.y;
+            values[5][lane] = invDir.z;
+            values[6][lane] = distance;
+            active |= 1 << lane;
+        }
+        if (active == 0) return;
+        stats.packets++;
+        RayPacket packet = {Lanes::load(values[0]), Lanes::load(values[1]), Lanes::load(values[2]),
+                            Lanes::load(values[3]), Lanes::load(values[4]), Lanes::load(values[5]),
+                            Lanes::load(values[6])};
+
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0 && active != 0) {
+            int index = stack[--top];
+            const BvhNode& node = nodes[index];
+            stats.rayBoxTests += std::popcount((unsigned)active);
+            int entering = slabPacket(packet, node.min, node.max) & active;
+            if (entering == 0) continue;
+            if ((entering & (entering - 1)) == 0) {
+                int lane = std::countr_zero((unsigned)entering);
+                stats.singleRays++;
+                if (cast(origins[lane], directions[lane], {0.0f, 0.0f, 0.0f}, lengths[lane], true, index).hit) {
+                    visible[lane] = 0;
+                    active &= ~entering;
+                }
+                continue;
+            }
+            if (node.count == 0) {
+                stack[top++] = node.first;
+                stack[top++] = node.first + 1;
+                continue;
+            }
+            for (int i = node.first; i < node.first + node.count && entering != 0; i++) {
+                int collider = order[i];
+                stats.rayBoxTests += std::popcount((unsigned)entering);
+                int blocked = slabPacket(packet, mins[collider], maxs[collider]) & entering;
+                entering &= ~blocked;
+                active &= ~blocked;
+                for (int lane = 0; lane < count; lane++) if (blocked & (1 << lane)) visible[lane] = 0;
+            }
+        }
+    }
+
+    // Line of sight for many segments, visible[i] is 1 when nothing blocks queries[i]. Segments are traced in
+    // packets of Lanes::WIDTH consecutive queries, so they are fastest when neighbouring queries go roughly the
+    // same way (e.g. grouped by NPC, or by region when they all look at the player).
+    void lineOfSightBatch(const std::vector<SightQuery>& queries, std::vector<unsigned char>& visible, int threads = 0,
+                          PacketStats* stats = nullptr) const {
+        visible.resize(queries.size());
+        int packets = ((int)queries.size() + Lanes::WIDTH - 1) / Lanes::WIDTH;
+        std::vector<PacketStats> perRange(stats ? (size_t)std::max(1, packets) : 0);
+        ParallelFor(packets, threads, [&](int begin, int end) {
+            PacketStats local;
+            for (int p = begin; p < end; p++) {
+                int first = p * Lanes::WIDTH;
+                int count = std::min(Lanes::WIDTH, (int)queries.size() - first);
+                lineOfSightPacket(&queries[first], count, &visible[first], local);
+            }
+            if (stats) perRange[begin] = local;
+        }, 32);
+        if (stats) {
+            for (const PacketStats& range : perRange) {
+                stats->packets += range.packets;
+                stats->rayBoxTests += range.rayBoxTests;
+                stats->singleRays += range.singleRays;
+            }
+        }
+    }
+
+    // Batches, threads <= 0 uses every hardware thread
+    void raycastBatch(const std::vector<RayQuery>& queries, std::vector<SceneHit>& hits, int threads = 0) const {
+        hits.resize(queries.size());
+        ParallelFor((int)queries.size(), threads, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) hits[i] = raycast(queries[i].origin, queries[i].direction, queries[i].maxDistance);
+        });
+    }
+
+    void boxCastBatch(const std::vector<BoxCastQuery>& queries, std::vector<SceneHit>& hits, int threads = 0) const {
+        hits.resize(queries.size());
+        ParallelFor((int)queries.size(), threads, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                const BoxCastQuery& query = queries[i];
+                hits[i] = boxCast(query.center, query.halfExtents, query.direction, query.maxDistance);
+            }
+        });
+    }
+
+    // One list of overlapping colliders per box, boxes given as min/max pairs
+    void overlapBatch(const std::vector<BoundingBox>& boxes, std::vector<std::vector<int>>& results, int threads = 0) const {
+        results.resize(boxes.size());
+        ParallelFor((int)boxes.size(), threads, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                results[i].clear();
+                overlap(boxes[i].min, boxes[i].max, results[i]);
+            }
+        });
+    }
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "net.h"
+
+// Conditions of a simulated network path, one direction
+struct LinkSettings {
+    double latencyMs = 0.0;     // One way
+    double jitterMs = 0.0;      // Each packet is delayed by latency plus up to this much, so they can reorder
+    double loss = 0.0;          // Fraction of packets dropped, 0-1
+};
+
+// One direction of a lossy, laggy link: packets go in with send() and come out of receive() once their delivery
+// time has passed. Time is whatever clock the caller passes in, so tests can run on simulated time.
+struct SimulatedLink {
+    struct Packet {
+        long long deliverNs;
+        std::vector<uint8_t> data;
+    };
+
+    LinkSettings settings;
+    std::mt19937 rng;
+    std::vector<Packet> inFlight;   // Min heap on delivery time
+    long long sent = 0, dropped = 0;
+
+    explicit SimulatedLink(const LinkSettings& settings = {}, unsigned seed = 1) : settings(settings), rng(seed) {}
+
+    static bool later(const Packet& a, const Packet& b) { return a.deliverNs > b.deliverNs; }
+
+    void send(const void* data, int size, long long nowNs) {
+        sent++;
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        if (unit(rng) < settings.loss) {
+            dropped++;
+            return;
+        }
+        double delayMs = settings.latencyMs + settings.jitterMs * unit(rng);
+        Packet packet = {nowNs + (long long)(delayMs * 1e6), std::vector<uint8_t>((const uint8_t*)data, (const uint8_t*)data + size)};
+        inFlight.push_back(std::move(packet));
+        std::push_heap(inFlight.begin(), inFlight.end(), later);
+    }
+
+    // Copies out the next packet due by nowNs, returns its size or -1 if none is
+    int receive(void* data, int capacity, long long nowNs) {
+        if (inFlight.empty() || inFlight.front().deliverNs > nowNs) return -1;
+        std::pop_heap(inFlight.begin(), inFlight.end(), later);
+        Packet packet = std::move(inFlight.back());
+        inFlight.pop_back();
+        int size = std::min(capacity, (int)packet.data.size());
+        memcpy(data, packet.data.data(), size);
+        return size;
+    }
+};
+
+// Puts a SimulatedLink each way between one UDP client and a server, without either knowing: the client talks to
+// the relay's address instead of the server's. Call pump() regularly.
+struct LinkRelay {
+    UdpSocket clientSide;   // The client sends here
+    UdpSocket serverSide;   // Talks to the server on the client's behalf
+    NetAddress server;
+    NetAddress client;
+    bool clientKnown = false;
+    SimulatedLink up, down;
+
+    LinkRelay(const LinkSettings& upSettings, const LinkSettings& downSettings, unsigned seed = 1)
+        : up(upSettings, seed), down(downSettings, seed + 1) {}
+
+    // Returns false if a socket can't be opened
+    bool open(const NetAddress& serverAddress) {
+        server = serverAddress;
+        return clientSide.open(0, true) && serverSide.open(0, true);
+    }
+
+    NetAddress address() const { return {0x7f000001u, clientSide.localPort()}; }
+
+    void pump(long long nowNs) {
+        uint8_t data[NET_MAX_PACKET];
+        NetAddress from;
+        int size;
+        while ((size = clientSide.receive(data, sizeof(data), from)) >= 0) {
+            client = from;
+            clientKnown = true;
+            up.send(data, size, nowNs);
+        }
+        while ((size = serverSide.receive(data, sizeof(data), from)) >= 0) down.send(data, size, nowNs);
+        while ((size = up.receive(data, sizeof(data), nowNs)) >= 0) serverSide.send(server, data, size);
+        while (clientKnown && (size = down.receive(data, sizeof(data), nowNs)) >= 0) clientSide.send(client, data, size);
+    }
+};
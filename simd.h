@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LANES_SSE2
+#endif
+
+// A group of floats processed together: 8 with AVX, 4 with SSE2 (every x86-64 build), and a plain 4 float array
+// anywhere else. Comparisons return a bit mask with bit i set for lane i; WhereLess(a, b, value) instead keeps value
+// in the lanes where a < b and zeroes the others. Min/Max pick the same operand as std::min/std::max do when a NaN is
+// involved, so vector code gives bit-identical results to scalar code using those.
+struct Lanes {
+#if defined(__AVX__)
+    static constexpr int WIDTH = 8;
+    __m256 v;
+
+    static Lanes set(float value) { return {_mm256_set1_ps(value)}; }
+    static Lanes load(const float* values) { return {_mm256_loadu_ps(values)}; }
+    void store(float* values) const { _mm256_storeu_ps(values, v); }
+
+    friend Lanes operator+(Lanes a, Lanes b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend Lanes operator-(Lanes a, Lanes b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend Lanes operator*(Lanes a, Lanes b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend Lanes operator/(Lanes a, Lanes b) { return {_mm256_div_ps(a.v, b.v)}; }
+    // The x86 instructions return their second operand when unordered, std::min(a, b) returns a
+    friend Lanes Min(Lanes a, Lanes b) { return {_mm256_min_ps(b.v, a.v)}; }
+    friend Lanes Max(Lanes a, Lanes b) { return {_mm256_max_ps(b.v, a.v)}; }
+
+    friend int Less(Lanes a, Lanes b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+    friend int Greater(Lanes a, Lanes b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+    friend Lanes WhereLess(Lanes a, Lanes b, Lanes value) { return {_mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ), value.v)}; }
+#elif defined(LANES_SSE2)
+    static constexpr int WIDTH = 4;
+    __m128 v;
+
+    static Lanes set(float value) { return {_mm_set1_ps(value)}; }
+    static Lanes load(const float* values) { return {_mm_loadu_ps(values)}; }
+    void store(float* values) const { _mm_storeu_ps(values, v); }
+
+    friend Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend Lanes operator/(Lanes a, Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+    // The x86 instructions return their second operand when unordered, std::min(a, b) returns a
+    friend Lanes Min(Lanes a, Lanes b) { return {_mm_min_ps(b.v, a.v)}; }
+    friend Lanes Max(Lanes a, Lanes b) { return {_mm_max_ps(b.v, a.v)}; }
+
+    friend int Less(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+    friend int Greater(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+    friend Lanes WhereLess(Lanes a, Lanes b, Lanes value) { return {_mm_and_ps(_mm_cmplt_ps(a.v, b.v), value.v)}; }
+#else
+    static constexpr int WIDTH = 4;
+    float v[WIDTH];
+
+    static Lanes set(float value) {
+        Lanes r;
+        for (int i = 0; i < WIDTH; i++) r.v[i] = value;
+        return r;
+    }
+    static Lanes load(const float* values) {
+        Lanes r;
+        for (int i = 0; i < WIDTH; i++) r.v[i] = values[i];
+        return r;
+    }
+    void store(float* values) const {
+        for (int i = 0; i < WIDTH; i++) values[i] = v[i];
+    }
+
+    template<typename Op>
+    static Lanes apply(Lanes a, Lanes b, Op op) {
+        Lanes r;
+        for (int i = 0; i < WIDTH; i++) r.v[i] = op(a.v[i], b.v[i]);
+        return r;
+    }
+    template<typename Op>
+    static int mask(Lanes a, Lanes b, Op op) {
+        int bits = 0;
+        for (int i = 0; i < WIDTH; i++) if (op(a.v[i], b.v[i])) bits |= 1 << i;
+        return bits;
+    }
+
+    friend Lanes operator+(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+    friend Lanes operator-(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+    friend Lanes operator*(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+    friend Lanes operator/(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x / y; }); }
+    friend Lanes Min(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return std::min(x, y); }); }
+    friend Lanes Max(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return std::max(x, y); }); }
+
+    friend int Less(Lanes a, Lanes b) { return mask(a, b, [](float x, float y) { return x < y; }); }
+    friend int Greater(Lanes a, Lanes b) { return mask(a, b, [](float x, float y) { return x > y; }); }
+    friend Lanes WhereLess(Lanes a, Lanes b, Lanes value) {
+        Lanes r;
+        for (int i = 0; i < WIDTH; i++) r.v[i] = a.v[i] < b.v[i] ? value.v[i] : 0.0f;
+        return r;
+    }
+#endif
+
+    static constexpr int ALL = (1 << WIDTH) - 1;
+
+    // 0, 1, 2... one per lane
+    static Lanes index() {
+        float values[WIDTH];
+        for (int i = 0; i < WIDTH; i++) values[i] = (float)i;
+        return load(values);
+    }
+
+    float sum() const {
+        float values[WIDTH];
+        store(values);
+        float total = 0.0f;
+        for (int i = 0; i < WIDTH; i++) total += values[i];
+        return total;
+    }
+};
+
+#undef LANES_SSE2
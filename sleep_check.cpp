@@ -0,0 +1,187 @@
+// Check for actor sleeping
+//
+// Runs the same crowd in two worlds: one as the game does, where idle actors fall asleep, and one that wakes
+// everybody before every step so nothing ever skips simulation. A few walkers roam a floor covered in grounded
+// actors, some of them on platforms that get dropped now and then, which has to wake whoever stands on them. After
+// every step the two worlds have to agree on where everyone is. Every few steps the sleeping world's bookkeeping is
+// checked too: awake list and sleeper grid consistent, and no sleeper left within WAKE_RADIUS of a walker that just
+// moved, other than one that dozed off in that same step (wakeNear() only looks at sleepers, the walker's next move
+// wakes it). Exits with 1 on the first failure. Reports the step cost of both worlds. Headless.
+// Options:
+//     --actors N        grounded actors (default 100000)
+//     --walkers N       of which walking around (default 100)
+//     --steps N         (default 600)
+//     --seed N          (default 1)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "world.h"
+
+constexpr float STEP_DT = 1.0f / 60.0f;
+constexpr float WALK_SPEED = 4.0f;
+constexpr float ACTOR_SPACING = 1.0f;
+constexpr float PLATFORM_SIZE = 12.0f;
+constexpr float PLATFORM_HEIGHT = 3.0f;
+constexpr int DROP_INTERVAL = 100;      // Steps between platforms sinking into the floor
+constexpr int AUDIT_INTERVAL = 10;
+constexpr float MAX_DEVIATION = 0.01f;  // Anything more would show
+
+// Everything a sleeping actor's bookkeeping has to agree on, empty if fine
+const char* Audit(const World& world)
+{
+    int sleeping = 0;
+    for (int i = 0; i < (int)world.actors.size(); i++) {
+        const Actor& actor = world.actors[i];
+        if (actor.sleeping) {
+            sleeping++;
+            if (actor.awakeSlot != -1) return "sleeper still has an awake slot";
+            auto it = world.sleepers.find(actor.sleepCell);
+            if (it == world.sleepers.end() || std::find(it->second.begin(), it->second.end(), i) == it->second.end()) {
+                return "sleeper missing from its grid cell";
+            }
+        } else if (actor.awakeSlot < 0 || actor.awakeSlot >= (int)world.awakeActors.size() ||
+                   world.awakeActors[actor.awakeSlot] != i) {
+            return "awake actor not in its awake slot";
+        }
+    }
+    size_t inCells = 0;
+    for (const auto& [cell, indices] : world.sleepers) inCells += indices.size();
+    if ((int)inCells != sleeping || (int)world.awakeActors.size() + sleeping != (int)world.actors.size()) {
+        return "awake list and sleeper grid don't add up";
+    }
+    return "";
+}
+
+int main(int argc, char** argv) {
+    int count = 100000;
+    int walkers = 100;
+    int steps = 600;
+    unsigned seed = 1;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--actors") == 0) count = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--walkers") == 0) walkers = std::max(0, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--steps") == 0) steps = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "--seed") == 0) seed = (unsigned)strtoul(argv[i + 1], nullptr, 10);
+    }
+    walkers = std::min(walkers, count);
+
+    // A floor with the actors on a grid over it, and platforms for some of them to stand on
+    int side = (int)ceilf(sqrtf((float)count));
+    float half = (float)side * ACTOR_SPACING * 0.5f;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Collider> level = {Collider({0.0f, 0.0f, 0.0f}, {half * 2.0f + 10.0f, 1.0f, half * 2.0f + 10.0f})};
+    int platforms = std::max(1, side * side / 2000);
+    for (int p = 0; p < platforms; p++) {
+        level.emplace_back(Vector3{(unit(rng) * 2.0f - 1.0f) * half, PLATFORM_HEIGHT, (unit(rng) * 2.0f - 1.0f) * half},
+            Vector3{PLATFORM_SIZE, 1.0f, PLATFORM_SIZE});
+    }
+    std::vector<Collider> sleepingColliders = level, awakeColliders = level;
+    const Vector3 dims = {0.5f, 1.0f, 0.5f};
+    Player parked[2] = {Player({0.0f, -1000.0f, 0.0f}, dims), Player({0.0f, -1000.0f, 0.0f}, dims)};
+    World sleepy(sleepingColliders, parked[0]), awake(awakeColliders, parked[1]);
+    for (int i = 0; i < count; i++) {
+        Vector3 at = {((float)(i % side) + 0.5f) * ACTOR_SPACING - half, 1.2f, ((float)(i / side) + 0.5f) * ACTOR_SPACING - half};
+        for (size_t c = 1; c < level.size(); c++) {
+            if (fabsf(at.x - level[c].position.x) < PLATFORM_SIZE * 0.5f && fabsf(at.z - level[c].position.z) < PLATFORM_SIZE * 0.5f) {
+                at.y = PLATFORM_HEIGHT + 1.2f;
+            }
+        }
+        sleepy.addActor(at, dims);
+        awake.addActor(at, dims);
+    }
+    // Walkers are spread over the crowd rather than bunched in its first rows
+    std::vector<int> walking;
+    for (int w = 0; w < walkers; w++) walking.push_back((int)((long long)w * count / walkers));
+
+    std::vector<Vector3> before(count);
+    std::vector<uint8_t> wasSleeping(count);
+    double sleepyMs = 0.0, awakeMs = 0.0;
+    long long awakeSteps = 0, audits = 0, wakeChecks = 0;
+    int drops = 0;
+    float worst = 0.0f;
+    for (int step = 0; step < steps; step++) {
+        // New headings now and then, and back towards the middle from the edge
+        for (int index : walking) {
+            const Vector3& p = sleepy.actors[index].body.position;
+            Vector3 move = sleepy.actors[index].move;
+            if (fabsf(p.x) > half || fabsf(p.z) > half) {
+                move = Vector3Normalize({-p.x, 0.0f, -p.z}) * WALK_SPEED;
+            } else if (step % 120 == 0 || unit(rng) < 0.01f) {
+                float a = unit(rng) * 2.0f * PI;
+                move = {cosf(a) * WALK_SPEED, 0.0f, sinf(a) * WALK_SPEED};
+            }
+            sleepy.applyInput(index, move);
+            awake.applyInput(index, move);
+        }
+        // Sink a platform into the floor, everyone on it has to fall whether asleep or not
+        if (step > 0 && step % DROP_INTERVAL == 0) {
+            Collider& platform = sleepingColliders[1 + drops % platforms];
+            platform.position.y = -1.0f;
+            awakeColliders[1 + drops % platforms].position.y = -1.0f;
+            sleepy.collidersChanged();
+            awake.collidersChanged();
+            drops++;
+        }
+        for (int i = 0; i < count; i++) {
+            before[i] = sleepy.actors[i].body.position;
+            wasSleeping[i] = sleepy.actors[i].sleeping;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        sleepy.step(STEP_DT);
+        sleepyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        awakeSteps += (long long)sleepy.awakeActors.size();
+        awake.wakeAll();
+        start = std::chrono::steady_clock::now();
+        awake.step(STEP_DT);
+        awakeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (int i = 0; i < count; i++) {
+            float off = Vector3Distance(sleepy.actors[i].body.position, awake.actors[i].body.position);
+            worst = std::max(worst, off);
+            if (off > MAX_DEVIATION) {
+                const Vector3& a = sleepy.actors[i].body.position;
+                const Vector3& b = awake.actors[i].body.position;
+                printf("Step %d: actor %d%s at (%.4f %.4f %.4f), simulated awake it's at (%.4f %.4f %.4f)\n",
+                    step, i, sleepy.actors[i].sleeping ? " (asleep)" : "", a.x, a.y, a.z, b.x, b.y, b.z);
+                return 1;
+            }
+        }
+        if (step % AUDIT_INTERVAL != 0) continue;
+        audits++;
+        const char* problem = Audit(sleepy);
+        if (*problem) {
+            printf("Step %d: %s\n", step, problem);
+            return 1;
+        }
+        for (int index : walking) {
+            const Vector3& p = sleepy.actors[index].body.position;
+            if (Vector3DistanceSqr(p, before[index]) <= SLEEP_MOVE_THRESHOLD * SLEEP_MOVE_THRESHOLD) continue;
+            for (int i = 0; i < count; i++) {
+                if (!sleepy.actors[i].sleeping || !wasSleeping[i] || Vector3DistanceSqr(sleepy.actors[i].body.position, p) > WAKE_RADIUS * WAKE_RADIUS) continue;
+                printf("Step %d: actor %d sleeps %.3f from walker %d, which just moved\n",
+                    step, i, Vector3Distance(sleepy.actors[i].body.position, p), index);
+                return 1;
+            }
+            wakeChecks++;
+        }
+    }
+
+    printf("%d actors, %d walking, %d steps, %d platforms dropped: %.1f awake on average\n",
+        count, walkers, steps, drops, (double)awakeSteps / steps);
+    printf("step: %.3f ms with sleeping, %.3f ms all awake\n", sleepyMs / steps, awakeMs / steps);
+    printf("%lld audits, %lld walkers checked for sleepers in reach, positions %.6f apart at most: all fine\n",
+        audits, wakeChecks, worst);
+    return 0;
+}
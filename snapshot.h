@@ -0,0 +1,280 @@
+#pragma once
+
+#include <raylib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "net.h"
+
+// Snapshot compression. Entity state is quantized to fixed point and then delta coded against a baseline the
+// receiver already has (the last snapshot it acknowledged). The bit stream is a list of operations in id order:
+// a new entity sent in full, a changed one sent as differences, or a removed one. Entities the receiver can predict
+// exactly are left out. That covers standing still, and also moving on at the same speed, because positions are
+// compared with the baseline extrapolated along its speed. Both ends do that extrapolation in integer math, so it
+// gives the same result on both.
+//
+// Encoding writes into a buffer the caller owns. Snapshots live in a preallocated history, so the steady state
+// allocates nothing.
+
+struct SnapshotSettings {
+    int positionScale = 1024;   // Quanta per unit, about a millimetre
+    int speedScale = 256;       // Quanta per unit/s
+    int tickRate = 120;         // Snapshot ticks per second, for the extrapolation
+};
+
+struct QuantizedEntity {
+    uint16_t id = 0;
+    uint8_t resting = 0;
+    int32_t position[3] = {0, 0, 0};
+    int32_t speed[3] = {0, 0, 0};
+
+    bool operator==(const QuantizedEntity& other) const {
+        return id == other.id && resting == other.resting &&
+               position[0] == other.position[0] && position[1] == other.position[1] && position[2] == other.position[2] &&
+               speed[0] == other.speed[0] && speed[1] == other.speed[1] && speed[2] == other.speed[2];
+    }
+};
+
+inline int32_t Quantize(float value, int scale) { return (int32_t)lrintf(value * (float)scale); }
+
+inline QuantizedEntity Quantize(const EntityState& entity, const SnapshotSettings& settings)
+{
+    QuantizedEntity q;
+    q.id = entity.id;
+    q.resting = entity.resting;
+    const float position[3] = {entity.position.x, entity.position.y, entity.position.z};
+    const float speed[3] = {entity.speed.x, entity.speed.y, entity.speed.z};
+    for (int axis = 0; axis < 3; axis++) {
+        q.position[axis] = Quantize(position[axis], settings.positionScale);
+        q.speed[axis] = Quantize(speed[axis], settings.speedScale);
+    }
+    return q;
+}
+
+inline EntityState Dequantize(const QuantizedEntity& q, const SnapshotSettings& settings)
+{
+    float p = 1.0f / (float)settings.positionScale, s = 1.0f / (float)settings.speedScale;
+    return {q.id,
+            {(float)q.position[0] * p, (float)q.position[1] * p, (float)q.position[2] * p},
+            {(float)q.speed[0] * s, (float)q.speed[1] * s, (float)q.speed[2] * s},
+            q.resting};
+}
+
+struct Snapshot {
+    uint32_t tick = 0;      // 0: empty slot
+    std::vector<QuantizedEntity> entities;  // Sorted by id
+};
+
+// The last few snapshots, to encode against (sender) or decode against (receiver)
+struct SnapshotHistory {
+    std::vector<Snapshot> slots;
+
+    explicit SnapshotHistory(int size = 32, int entityCapacity = 0) : slots(size) {
+        for (Snapshot& snapshot : slots) snapshot.entities.reserve(entityCapacity);
+    }
+
+    // Slot to fill for a new tick, reusing the oldest one's storage
+    Snapshot& start(uint32_t tick) {
+        Snapshot& snapshot = slots[tick % slots.size()];
+        snapshot.tick = tick;
+        snapshot.entities.clear();
+        return snapshot;
+    }
+
+    const Snapshot* find(uint32_t tick) const {
+        if (tick == 0) return nullptr;
+        const Snapshot& snapshot = slots[tick % slots.size()];
+        return snapshot.tick == tick ? &snapshot : nullptr;
+    }
+};
+
+// Little endian bit stream into a fixed buffer. Overflow sets failed.
+struct BitWriter {
+    uint8_t* data;
+    int capacity;
+    int bytes = 0;
+    uint64_t scratch = 0;
+    int scratchBits = 0;
+    bool failed = false;
+
+    BitWriter(uint8_t* data, int capacity) : data(data), capacity(capacity) {}
+
+    void write(uint32_t value, int bits) {
+        if (bits == 0) return;
+        scratch |= ((uint64_t)value & ((1ull << bits) - 1)) << scratchBits;
+        scratchBits += bits;
+        while (scratchBits >= 8) {
+            if (bytes >= capacity) {
+                failed = true;
+                return;
+            }
+            data[bytes++] = (uint8_t)scratch;
+            scratch >>= 8;
+            scratchBits -= 8;
+        }
+    }
+
+    // Pads the last byte, returns the size written
+    int finish() {
+        if (scratchBits > 0) write(0, 8 - scratchBits);
+        return bytes;
+    }
+};
+
+// Reads a BitWriter stream back. Past the end it returns zeros and sets failed.
+struct BitReader {
+    const uint8_t* data;
+    int size;
+    int offset = 0;
+    uint64_t scratch = 0;
+    int scratchBits = 0;
+    bool failed = false;
+
+    BitReader(const uint8_t* data, int size) : data(data), size(size) {}
+
+    uint32_t read(int bits) {
+        if (bits == 0) return 0;
+        while (scratchBits < bits) {
+            if (offset >= size) {
+                failed = true;
+                return 0;
+            }
+            scratch |= (uint64_t)data[offset++] << scratchBits;
+            scratchBits += 8;
+        }
+        uint32_t value = (uint32_t)(scratch & ((1ull << bits) - 1));
+        scratch >>= bits;
+        scratchBits -= bits;
+        return value;
+    }
+};
+
+// Variable length integers: a 2 bit size class, then that many bits. Zero, the common case, costs two bits.
+constexpr int SNAPSHOT_CLASS_BITS[4] = {0, 6, 12, 32};
+
+inline void WriteVar(BitWriter& writer, uint32_t value)
+{
+    int sizeClass = value == 0 ? 0 : value < (1u << 6) ? 1 : value < (1u << 12) ? 2 : 3;
+    writer.write((uint32_t)sizeClass, 2);
+    writer.write(value, SNAPSHOT_CLASS_BITS[sizeClass]);
+}
+
+inline uint32_t ReadVar(BitReader& reader)
+{
+    return reader.read(SNAPSHOT_CLASS_BITS[reader.read(2)]);
+}
+
+inline void WriteSigned(BitWriter& writer, int32_t value) { WriteVar(writer, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31)); }
+
+inline int32_t ReadSigned(BitReader& reader)
+{
+    uint32_t zigzag = ReadVar(reader);
+    return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+enum SnapshotOp : uint32_t { SNAPSHOT_END = 0, SNAPSHOT_UPDATE = 1, SNAPSHOT_REMOVE = 2 };
+
+struct SnapshotCodec {
+    SnapshotSettings settings;
+
+    // Where the receiver will assume a baseline entity is elapsed ticks later if told nothing
+    void extrapolate(const QuantizedEntity& baseline, uint32_t elapsed, QuantizedEntity& out) const {
+        out = baseline;
+        int64_t divisor = (int64_t)settings.speedScale * settings.tickRate;
+        for (int axis = 0; axis < 3; axis++) {
+            int64_t travel = (int64_t)baseline.speed[axis] * settings.positionScale * elapsed;
+            // Rounded half away from zero, the same on every platform
+            int64_t rounded = travel >= 0 ? (travel + divisor / 2) / divisor : -((-travel + divisor / 2) / divisor);
+            out.position[axis] = (int32_t)(baseline.position[axis] + rounded);
+        }
+    }
+
+    // Encodes current against baseline (null: send everything). Returns the byte size, or -1 if it doesn't fit.
+    int encode(const Snapshot& current, const Snapshot* baseline, uint8_t* out, int capacity) const {
+        BitWriter writer(out, capacity);
+        uint32_t elapsed = baseline ? current.tick - baseline->tick : 0;
+        int lastId = -1;
+        auto op = [&](SnapshotOp kind, int id) {
+            writer.write(kind, 2);
+            WriteVar(writer, (uint32_t)(id - lastId - 1));
+            lastId = id;
+        };
+        size_t b = 0;
+        const size_t baseCount = baseline ? baseline->entities.size() : 0;
+        QuantizedEntity expected;
+        for (const QuantizedEntity& entity : current.entities) {
+            while (b < baseCount && baseline->entities[b].id < entity.id) op(SNAPSHOT_REMOVE, baseline->entities[b++].id);
+            if (b < baseCount && baseline->entities[b].id == entity.id) {
+                extrapolate(baseline->entities[b++], elapsed, expected);
+                if (entity == expected) continue;
+                op(SNAPSHOT_UPDATE, entity.id);
+                bool moved = entity.position[0] != expected.position[0] || entity.position[1] != expected.position[1] ||
+                             entity.position[2] != expected.position[2];
+                bool sped = entity.speed[0] != expected.speed[0] || entity.speed[1] != expected.speed[1] ||
+                            entity.speed[2] != expected.speed[2];
+                writer.write(moved, 1);
+                if (moved) for (int axis = 0; axis < 3; axis++) WriteSigned(writer, entity.position[axis] - expected.position[axis]);
+                writer.write(sped, 1);
+                if (sped) for (int axis = 0; axis < 3; axis++) WriteSigned(writer, entity.speed[axis] - expected.speed[axis]);
+            } else {
+                op(SNAPSHOT_UPDATE, entity.id);
+                for (int axis = 0; axis < 3; axis++) WriteSigned(writer, entity.position[axis]);
+                for (int axis = 0; axis < 3; axis++) WriteSigned(writer, entity.speed[axis]);
+            }
+            writer.write(entity.resting, 1);
+        }
+        while (b < baseCount) op(SNAPSHOT_REMOVE, baseline->entities[b++].id);
+        writer.write(SNAPSHOT_END, 2);
+        int size = writer.finish();
+        return writer.failed ? -1 : size;
+    }
+
+    // Rebuilds the snapshot encoded against baseline into out, whose tick has to be set already. False if the data
+    // is broken or the baseline doesn't match.
+    bool decode(const uint8_t* data, int size, const Snapshot* baseline, Snapshot& out) const {
+        BitReader reader(data, size);
+        out.entities.clear();
+        uint32_t elapsed = baseline ? out.tick - baseline->tick : 0;
+        size_t b = 0;
+        const size_t baseCount = baseline ? baseline->entities.size() : 0;
+        QuantizedEntity entity;
+        int lastId = -1;
+        while (true) {
+            uint32_t kind = reader.read(2);
+            if (reader.failed || kind > SNAPSHOT_REMOVE) return false;
+            if (kind == SNAPSHOT_END) break;
+            int id = lastId + 1 + (int)ReadVar(reader);
+            if (id > 65535) return false;
+            lastId = id;
+            // Everything before the operation carries over as predicted
+            while (b < baseCount && baseline->entities[b].id < id) {
+                extrapolate(baseline->entities[b++], elapsed, entity);
+                out.entities.push_back(entity);
+            }
+            bool inBaseline = b < baseCount && baseline->entities[b].id == id;
+            if (kind == SNAPSHOT_REMOVE) {
+                if (!inBaseline) return false;
+                b++;
+                continue;
+            }
+            if (inBaseline) {
+                extrapolate(baseline->entities[b++], elapsed, entity);
+                if (reader.read(1)) for (int axis = 0; axis < 3; axis++) entity.position[axis] += ReadSigned(reader);
+                if (reader.read(1)) for (int axis = 0; axis < 3; axis++) entity.speed[axis] += ReadSigned(reader);
+            } else {
+                entity.id = (uint16_t)id;
+                for (int axis = 0; axis < 3; axis++) entity.position[axis] = ReadSigned(reader);
+                for (int axis = 0; axis < 3; axis++) entity.speed[axis] = ReadSigned(reader);
+            }
+            entity.resting = (uint8_t)reader.read(1);
+            out.entities.push_back(entity);
+        }
+        while (b < baseCount) {
+            extrapolate(baseline->entities[b++], elapsed, entity);
+            out.entities.push_back(entity);
+        }
+        return !reader.failed;
+    }
+};
@@ -0,0 +1,242 @@
+// Benchmark for delta compressed snapshots
+//
+// Simulates a 1000 entity scene, actors wandering or standing around a large level, and sends its snapshots at
+// 60 Hz to a set of simulated clients with different round trip times and packet loss. Each client acknowledges
+// what it decoded and the encoder works against its last acknowledgement, the same as GameServer does. Reports the
+// bandwidth per client next to sending raw floats and next to quantized full snapshots, the encode time, and checks
+// every decoded snapshot against the original. Heap allocations during encoding are counted, there should be none.
+// Headless.
+// Options:
+//     --entities N      scene size (default 1000)
+//     --seconds N       simulated time (default 20)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "world.h"
+#include "collider_merge.h"
+#include "net.h"
+#include "snapshot.h"
+
+// Counts heap allocations while counting is on. Every form of new and delete is replaced, so whatever the encoder
+// or the library might use goes through here and is freed by the matching function.
+std::atomic<bool> countAllocations{false};
+std::atomic<long long> allocations{0};
+
+void* CountedAlloc(size_t size) noexcept
+{
+    if (countAllocations.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+// Over-allocates and keeps malloc's pointer just below the aligned block, so plain free() releases it everywhere
+void* CountedAlignedAlloc(size_t size, std::align_val_t alignment) noexcept
+{
+    size_t align = std::max((size_t)alignment, sizeof(void*));
+    char* raw = (char*)CountedAlloc(size + align + sizeof(void*));
+    if (!raw) return nullptr;
+    char* block = (char*)(((uintptr_t)raw + sizeof(void*) + align - 1) & ~(uintptr_t)(align - 1));
+    ((void**)block)[-1] = raw;
+    return block;
+}
+
+// Out of line, so GCC doesn't inline the deletes into their callers and take free() on a new'd pointer for a mismatch
+[[gnu::noinline]] void CountedFree(void* p) noexcept
+{
+    free(p);
+}
+
+void CountedAlignedFree(void* p) noexcept
+{
+    if (p) CountedFree(((void**)p)[-1]);
+}
+
+void* operator new(size_t size)
+{
+    if (void* p = CountedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size)
+{
+    if (void* p = CountedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (void* p = CountedAlignedAlloc(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    if (void* p = CountedAlignedAlloc(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAlignedAlloc(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAlignedAlloc(size, alignment); }
+
+void operator delete(void* p) noexcept { CountedFree(p); }
+void operator delete[](void* p) noexcept { CountedFree(p); }
+void operator delete(void* p, size_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, size_t) noexcept { CountedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { CountedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { CountedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { CountedAlignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { CountedAlignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { CountedAlignedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { CountedAlignedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { CountedAlignedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { CountedAlignedFree(p); }
+
+constexpr int TICK_RATE = 120;
+constexpr int SEND_INTERVAL = 2;
+constexpr float TICK_DT = 1.0f / (float)TICK_RATE;
+
+struct SimulatedClient {
+    const char* name;
+    int rttTicks;           // Acknowledgements arrive this long after the snapshot was sent
+    double loss;            // Of snapshots, and separately of acknowledgements
+    SnapshotHistory received{64};
+    uint32_t acked = 0;     // As the server knows it
+    std::vector<std::pair<uint32_t, uint32_t>> acksInFlight;    // (arrival tick, acknowledged tick)
+    long long bytes = 0, sent = 0, decoded = 0, lost = 0, mismatches = 0;
+    double encodeMs = 0.0;
+
+    SimulatedClient(const char* name, int rttTicks, double loss) : name(name), rttTicks(rttTicks), loss(loss) {}
+};
+
+int main(int argc, char** argv) {
+    int count = 1000;
+    double seconds = 20.0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--entities") == 0) count = std::clamp(atoi(argv[i + 1]), 1, 65535);
+        else if (strcmp(argv[i], "--seconds") == 0) seconds = std::max(1.0, atof(argv[i + 1]));
+    }
+
+    // Scene: a big plate with pillars, actors spread over it
+    float half = 80.0f;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> spread(-half + 2.0f, half - 2.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+    std::vector<Collider> colliders = {Collider({0.0f, 0.475f, 0.0f}, {half * 2.0f, 0.05f, half * 2.0f})};
+    for (int i = 0; i < 40; i++) colliders.push_back(Collider({spread(rng), 0.5f, spread(rng)}, {1.0f, 10.0f, 1.0f}));
+    colliders = MergeColliders(colliders).colliders;
+    Player player({0.0f, -1000.0f, 0.0f}, {0.5f, 1.0f, 0.5f});
+    World world(colliders, player);
+    for (int i = 0; i < count; i++) world.addActor({spread(rng), 1.0f, spread(rng)}, {0.5f, 1.0f, 0.5f});
+
+    SnapshotCodec codec;
+    codec.settings.tickRate = TICK_RATE;
+    SnapshotHistory history(64, count);
+    std::vector<uint8_t> buffer(NET_MAX_SNAPSHOT * 4);
+    std::vector<SimulatedClient> clients = {
+        {"LAN", 2, 0.0}, {"30 ms", 4, 0.0}, {"100 ms", 12, 0.01}, {"100 ms 5% loss", 12, 0.05},
+        {"250 ms 10% loss", 30, 0.10}, {"500 ms 20% loss", 60, 0.20},
+    };
+    for (SimulatedClient& client : clients) client.acksInFlight.reserve(256);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    const int ticks = (int)(seconds * TICK_RATE);
+    long long fullBytes = 0, sends = 0;
+    double fullMs = 0.0;
+    for (int tick = 1; tick <= ticks; tick++) {
+        // A third of the scene stands still, the rest wanders and turns now and then
+        for (int i = 0; i < count; i++) {
+            if (i % 3 == 0) continue;
+            if (tick == 1 || rng() % 240 == 0) {
+                float a = angle(rng);
+                float run = 2.0f + (float)(i % 5);
+                world.applyInput(i, {cosf(a) * run, 0.0f, sinf(a) * run});
+            }
+            const Vector3& p = world.actors[i].body.position;
+            if (fabsf(p.x) > half - 3.0f || fabsf(p.z) > half - 3.0f) world.applyInput(i, {-p.x * 0.1f, 0.0f, -p.z * 0.1f});
+        }
+        world.step(TICK_DT);
+        if (tick % SEND_INTERVAL != 0) continue;
+
+        Snapshot& current = history.start((uint32_t)tick);
+        for (int i = 0; i < count; i++) {
+            const Actor& actor = world.actors[i];
+            current.entities.push_back(Quantize({(uint16_t)i, actor.body.position, actor.speed, (uint8_t)actor.body.isResting}, codec.settings));
+        }
+        sends++;
+
+        auto fullStart = std::chrono::steady_clock::now();
+        countAllocations = true;
+        int full = codec.encode(current, nullptr, buffer.data(), (int)buffer.size());
+        countAllocations = false;
+        fullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fullStart).count();
+        fullBytes += full;
+
+        for (SimulatedClient& client : clients) {
+            // Acknowledgements that have arrived by now
+            for (size_t a = 0; a < client.acksInFlight.size(); ) {
+                if (client.acksInFlight[a].first <= (uint32_t)tick) {
+                    client.acked = std::max(client.acked, client.acksInFlight[a].second);
+                    client.acksInFlight[a] = client.acksInFlight.back();
+                    client.acksInFlight.pop_back();
+                } else {
+                    a++;
+                }
+            }
+            const Snapshot* baseline = history.find(client.acked);
+            auto start = std::chrono::steady_clock::now();
+            countAllocations = true;
+            int size = codec.encode(current, baseline, buffer.data(), (int)buffer.size());
+            countAllocations = false;
+            client.encodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            client.sent++;
+            client.bytes += size;
+
+            if (unit(rng) < client.loss) {
+                client.lost++;
+                continue;
+            }
+            // The client decodes it against its own copy of the baseline and checks the result
+            const Snapshot* clientBaseline = client.received.find(baseline ? baseline->tick : 0);
+            if (baseline && !clientBaseline) {
+                client.mismatches++;
+                continue;
+            }
+            Snapshot& decoded = client.received.start(current.tick);
+            if (!codec.decode(buffer.data(), size, clientBaseline, decoded) || decoded.entities.size() != current.entities.size()) {
+                client.mismatches++;
+                decoded.tick = 0;
+                continue;
+            }
+            for (size_t e = 0; e < current.entities.size(); e++) {
+                if (!(decoded.entities[e] == current.entities[e])) {
+                    client.mismatches++;
+                    break;
+                }
+            }
+            client.decoded++;
+            if (unit(rng) >= client.loss) client.acksInFlight.push_back({(uint32_t)tick + client.rttTicks, current.tick});
+        }
+    }
+
+    double sendRate = (double)TICK_RATE / SEND_INTERVAL;
+    double rawPerSecond = (double)count * (2 + 12 + 12 + 1) * sendRate;
+    printf("%d entities, %lld snapshots at %.0f Hz\n", count, sends, sendRate);
+    printf("raw floats:       %8.1f kB/s per client\n", rawPerSecond / 1000.0);
+    printf("quantized full:   %8.1f kB/s per client, %.3f ms to encode\n", (double)fullBytes / sends * sendRate / 1000.0, fullMs / sends);
+    for (const SimulatedClient& client : clients) {
+        printf("%-16s  %8.1f kB/s per client (%.1f%% of raw), %.3f ms to encode, %lld decoded, %lld lost, %lld mismatches\n",
+            client.name, (double)client.bytes / client.sent * sendRate / 1000.0,
+            100.0 * (double)client.bytes / client.sent * sendRate / rawPerSecond, client.encodeMs / client.sent,
+            client.decoded, client.lost, client.mismatches);
+    }
+    printf("heap allocations while encoding: %lld\n", allocations.load());
+    return 0;
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "net.h"
+#include "snapshot.h"
+#include "parallel.h"
+
+struct SpectatorSettings {
+    int delaySnapshots = 0;         // Spectators see the match this many snapshots late
+    int keyframeInterval = 120;     // Snapshots between full ones: the longest a joiner, or a spectator that lost a
+                                    // packet, waits for a picture
+    int threads = 1;                // For the sends, with many spectators. 0 is one per hardware thread.
+};
+
+// One published snapshot, encoded and already cut into State packets, shared by every spectator it goes to
+struct SpectatorFrame {
+    uint32_t sequence = 0;
+    uint32_t tick = 0;
+    bool keyframe = false;
+    std::vector<uint8_t> data;      // The packets back to back
+    std::vector<int> packetEnd;     // End offset of each packet in data
+};
+
+struct Spectator {
+    NetAddress address;
+    uint32_t next = 0;              // Sequence of the next frame to send it, 0 until it got a keyframe
+    uint32_t lastHeard = 0;
+};
+
+// Broadcasts one match to any number of spectators. Spectators don't acknowledge anything, so they all get the
+// same stream: each snapshot delta coded against the one before it, with a full keyframe every
+// settings.keyframeInterval. publish() encodes a snapshot once and cuts it into packets in a SpectatorFrame.
+// fanOut() then hands every spectator the frames it's due, straight from those shared buffers, so a thousand
+// spectators cost one encode and a thousand socket writes. Frames are kept in a ring as shared_ptrs, long enough
+// to cover the delay and one keyframe interval. A late joiner starts at the last keyframe at or before its delayed
+// position and gets the deltas since in one burst. A frame whose buffer nobody else holds any more is reused.
+//
+// Losing a delta breaks a spectator's chain until the next keyframe, the price of not having acknowledgements.
+struct SpectatorChannel {
+    SpectatorSettings settings;
+    SnapshotCodec codec;
+    Snapshot snapshots[2];          // The one being published and the one before it
+    int currentSnapshot = 0;
+    bool chained = false;           // The previous publish() was the previous snapshot, a delta against it works
+    int sinceKeyframe = 0;
+    std::vector<std::shared_ptr<SpectatorFrame>> ring;
+    uint32_t newest = 0;            // Sequence of the last frame published, counting from 1
+    std::vector<Spectator> spectators;
+    std::unordered_map<uint64_t, int> spectatorAt;  // Address key -> index into spectators
+    std::vector<uint8_t> encoded = std::vector<uint8_t>(NET_MAX_SNAPSHOT);
+    // Since start
+    long long frames = 0, keyframes = 0, packetsOut = 0, bytesOut = 0;
+    double encodeMs = 0.0, fanOutMs = 0.0;
+
+    static uint64_t addressKey(const NetAddress& address) { return (uint64_t)address.ip << 16 | address.port; }
+
+    int ringSize() const { return settings.delaySnapshots + settings.keyframeInterval + 2; }
+
+    const SpectatorFrame* frame(uint32_t sequence) const {
+        if (sequence == 0 || ring.empty()) return nullptr;
+        const std::shared_ptr<SpectatorFrame>& slot = ring[sequence % ring.size()];
+        return slot && slot->sequence == sequence ? slot.get() : nullptr;
+    }
+
+    // Adds a spectator or, if it's already watching, notes it's still there. True if it's new.
+    bool join(const NetAddress& address, uint32_t tick) {
+        auto found = spectatorAt.find(addressKey(address));
+        if (found != spectatorAt.end()) {
+            spectators[found->second].lastHeard = tick;
+            return false;
+        }
+        spectatorAt[addressKey(address)] = (int)spectators.size();
+        spectators.push_back({address, 0, tick});
+        return true;
+    }
+
+    bool leave(const NetAddress& address) {
+        auto found = spectatorAt.find(addressKey(address));
+        if (found == spectatorAt.end()) return false;
+        remove(found->second);
+        return true;
+    }
+
+    void remove(int index) {
+        spectatorAt.erase(addressKey(spectators[index].address));
+        if (index != (int)spectators.size() - 1) {
+            spectators[index] = spectators.back();
+            spectatorAt[addressKey(spectators[index].address)] = index;
+        }
+        spectators.pop_back();
+    }
+
+    // Drops spectators not heard from for timeout ticks
+    void expire(uint32_t tick, uint32_t timeout) {
+        for (int i = (int)spectators.size() - 1; i >= 0; i--) {
+            if (tick - spectators[i].lastHeard > timeout) remove(i);
+        }
+    }
+
+    // Skipping publish() while nobody watches breaks the chain, the next frame is a keyframe
+    void idle() { chained = false; }
+
+    // Snapshot to fill for tick, entities sorted by id, then publish()
+    Snapshot& begin(uint32_t tick) {
+        currentSnapshot ^= 1;
+        Snapshot& snapshot = snapshots[currentSnapshot];
+        snapshot.tick = tick;
+        snapshot.entities.clear();
+        return snapshot;
+    }
+
+    // Encodes the snapshot from begin() once, into the next frame of the ring
+    void publish() {
+        auto start = std::chrono::steady_clock::now();
+        if ((int)ring.size() != ringSize()) {
+            ring.assign(ringSize(), nullptr);
+            chained = false;
+        }
+        const Snapshot& current = snapshots[currentSnapshot];
+        bool keyframe = !chained || ++sinceKeyframe >= settings.keyframeInterval;
+        const Snapshot* baseline = keyframe ? nullptr : &snapshots[currentSnapshot ^ 1];
+        int size = codec.encode(current, baseline, encoded.data(), (int)encoded.size());
+        if (size < 0) {
+            chained = false;    // Doesn't fit, spectators get nothing until the world shrinks
+            return;
+        }
+        if (keyframe) sinceKeyframe = 0;
+        chained = true;
+
+        std::shared_ptr<SpectatorFrame>& slot = ring[++newest % ring.size()];
+        // Reuse the buffer of the frame this one replaces, unless a send somewhere still holds it
+        if (!slot || slot.use_count() > 1) slot = std::make_shared<SpectatorFrame>();
+        SpectatorFrame& out = *slot;
+        out.sequence = newest;
+        out.tick = current.tick;
+        out.keyframe = keyframe;
+        out.data.resize((size_t)std::max(1, (size + NET_STATE_PIECE - 1) / NET_STATE_PIECE) * NET_MAX_PACKET);
+        out.packetEnd.clear();
+        int parts = std::max(1, (size + NET_STATE_PIECE - 1) / NET_STATE_PIECE);
+        int end = 0;
+        for (int part = 0; part < parts; part++) {
+            int offset = part * NET_STATE_PIECE;
+            end += WriteStatePart(out.data.data() + end, current.tick, baseline ? baseline->tick : 0u, 0, part, parts,
+                encoded.data() + offset, std::min(NET_STATE_PIECE, size - offset));
+            out.packetEnd.push_back(end);
+        }
+        out.data.resize(end);
+        frames++;
+        keyframes += keyframe;
+        encodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Sends every spectator the frames it's due, up to settings.delaySnapshots behind the newest
+    void fanOut(const UdpSocket& socket) {
+        if (spectators.empty() || newest <= (uint32_t)settings.delaySnapshots) return;
+        auto start = std::chrono::steady_clock::now();
+        uint32_t target = newest - (uint32_t)settings.delaySnapshots;
+        if (!frame(target)) return;
+        // Where a spectator without a picture starts: the last keyframe at or before target
+        uint32_t entry = 0;
+        for (uint32_t sequence = target; sequence > 0 && frame(sequence); sequence--) {
+            if (frame(sequence)->keyframe) {
+                entry = sequence;
+                break;
+            }
+        }
+        // A spectator whose next frame dropped out of the ring starts over at a keyframe
+        for (Spectator& spectator : spectators) {
+            if (spectator.next != 0 && spectator.next <= target && !frame(spectator.next)) spectator.next = 0;
+        }
+        uint32_t oldest = target;
+        for (const Spectator& spectator : spectators) {
+            uint32_t from = spectator.next != 0 ? spectator.next : entry;
+            if (from != 0) oldest = std::min(oldest, from);
+        }
+        // Hold the frames being sent, publish() mustn't reuse them under a sender
+        std::vector<std::shared_ptr<const SpectatorFrame>> sending;
+        for (uint32_t sequence = oldest; sequence <= target; sequence++) sending.push_back(ring[sequence % ring.size()]);
+
+        // One counter per range the sends get split into
+        const int minPerThread = 256;
+        int rangeCount = ParallelRanges((int)spectators.size(), settings.threads, minPerThread);
+        std::vector<long long> packets(rangeCount, 0), bytes(rangeCount, 0);
+        std::atomic<int> ranges{0};
+        ParallelFor((int)spectators.size(), settings.threads, [&](int first, int last) {
+            int range = ranges.fetch_add(1, std::memory_order_relaxed);
+            for (int s = first; s < last; s++) {
+                Spectator& spectator = spectators[s];
+                uint32_t from = spectator.next != 0 ? spectator.next : entry;
+                if (from == 0 || from > target) continue;
+                for (uint32_t sequence = from; sequence <= target; sequence++) {
+                    const SpectatorFrame& out = *sending[sequence - oldest];
+                    int begin = 0;
+                    for (int end : out.packetEnd) {
+                        if (socket.send(spectator.address, out.data.data() + begin, end - begin)) {
+                            packets[range]++;
+                            bytes[range] += end - begin;
+                        }
+                        begin = end;
+                    }
+                }
+                spectator.next = target + 1;
+            }
+        }, minPerThread);
+        for (size_t r = 0; r < packets.size(); r++) {
+            packetsOut += packets[r];
+            bytesOut += bytes[r];
+        }
+        fanOutMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
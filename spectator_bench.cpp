@@ -0,0 +1,142 @@
+// Benchmark for broadcasting a match to spectators
+//
+// Runs one GameServer with a wandering crowd and no players, watched by growing numbers of spectators over
+// loopback. Most of them are bare sockets that ask to spectate once a second and never read what they get, the
+// load the server sees from a crowd of viewers. A few are real GameClient spectators, some joining late, which
+// decode the stream and time how long they waited for their first picture. Ticks run back to back rather than on
+// the clock. Reports what publishing (the one encode per snapshot) and fanning out cost, per spectator too, and
+// what encoding for every viewer separately would have cost instead. Headless.
+// Options:
+//     --spectators A,B,C    spectator counts to test (default 1,100,1000,4000)
+//     --npcs N          crowd size (default 400)
+//     --threads N       threads for the fan out, 0 for one per hardware thread (default 1)
+//     --delay N         seconds spectators are kept behind (default 0)
+//     --seconds N       simulated time per count (default 10)
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "game_server.h"
+#include "game_client.h"
+#include "frame_pacer.h"
+
+constexpr int WATCHERS = 8;     // Real GameClient spectators, half of them joining halfway through
+
+int main(int argc, char** argv) {
+    std::vector<int> counts = {1, 100, 1000, 4000};
+    int npcs = 400;
+    int threads = 1;
+    double delay = 0.0;
+    double seconds = 10.0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--spectators") == 0) {
+            counts.clear();
+            for (char* p = argv[i + 1]; *p; ) {
+                counts.push_back(std::clamp((int)strtol(p, &p, 10), WATCHERS, 60000));
+                if (*p == ',') p++;
+                else break;
+            }
+        } else if (strcmp(argv[i], "--npcs") == 0) {
+            npcs = std::clamp(atoi(argv[i + 1]), 1, SERVER_MAX_ENTITIES - 1);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = std::max(0, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--delay") == 0) {
+            delay = std::clamp(atof(argv[i + 1]), 0.0, 60.0);
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = std::max(2.0, atof(argv[i + 1]));
+        }
+    }
+
+    const int ticks = (int)(seconds * SERVER_TICK_RATE);
+    const int lateJoin = ticks / 2;
+    const double snapshotsPerSecond = (double)SERVER_TICK_RATE / SERVER_SEND_INTERVAL;
+    for (int count : counts) {
+        count = std::max(count, WATCHERS);
+        GameServer server(7, 100.0f);
+        server.spectators.settings.threads = threads;
+        server.spectators.settings.delaySnapshots = (int)(delay * snapshotsPerSecond + 0.5);
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> spread(-48.0f, 48.0f);
+        for (int i = 0; i < npcs; i++) server.addNpc({spread(rng), 1.0f, spread(rng)});
+        if (!server.listen(0, true)) {
+            fprintf(stderr, "Can't open the server socket\n");
+            return 1;
+        }
+        const NetAddress address = {0x7f000001u, server.socket.localPort()};
+
+        // The silent crowd, with small buffers since nobody empties them
+        std::vector<UdpSocket> crowd(count - WATCHERS);
+        for (UdpSocket& socket : crowd) {
+            if (!socket.open(0, true, 16 * 1024)) {
+                fprintf(stderr, "Can't open spectator socket %d, raise the open file limit\n", (int)(&socket - crowd.data()));
+                return 1;
+            }
+        }
+        std::vector<std::unique_ptr<GameClient>> watchers;
+        std::vector<int> joinedAt(WATCHERS, -1), firstPictureAt(WATCHERS, -1);
+        for (int w = 0; w < WATCHERS; w++) {
+            watchers.push_back(std::make_unique<GameClient>());
+            watchers.back()->spectator = true;
+            if (!watchers.back()->open(address, true)) {
+                fprintf(stderr, "Can't open a watcher socket\n");
+                return 1;
+            }
+        }
+
+        uint8_t hello[8];
+        NetWriter writer(hello, sizeof(hello));
+        writer.put(NetMessage::Spectate);
+        writer.put(NET_PROTOCOL_VERSION);
+        double tickMs = 0.0;
+        for (int tick = 0; tick < ticks; tick++) {
+            // Spread the keepalives over the second
+            for (size_t s = tick % SERVER_TICK_RATE; s < crowd.size(); s += SERVER_TICK_RATE) crowd[s].send(address, hello, writer.size);
+            for (int w = 0; w < WATCHERS; w++) {
+                if (w >= WATCHERS / 2 && tick < lateJoin) continue;
+                GameClient& watcher = *watchers[w];
+                if (joinedAt[w] < 0) joinedAt[w] = tick;
+                if ((tick - joinedAt[w]) % SERVER_TICK_RATE == 0) watcher.sendHello();
+                watcher.poll();
+                if (firstPictureAt[w] < 0 && watcher.snapshots > 0) firstPictureAt[w] = tick;
+            }
+            auto start = std::chrono::steady_clock::now();
+            server.receive();
+            server.tick();
+            tickMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        long long decoded = 0, undecodable = 0;
+        double waitMs[2] = {0.0, 0.0};
+        int pictured[2] = {0, 0};
+        for (int w = 0; w < WATCHERS; w++) {
+            decoded += watchers[w]->snapshots;
+            undecodable += watchers[w]->undecodable;
+            watchers[w]->disconnect();
+            if (firstPictureAt[w] < 0) continue;
+            int late = w >= WATCHERS / 2;
+            waitMs[late] += (double)(firstPictureAt[w] - joinedAt[w]) * 1000.0 / SERVER_TICK_RATE;
+            pictured[late]++;
+        }
+        const SpectatorChannel& channel = server.spectators;
+        double frames = (double)std::max(channel.frames, 1LL);
+        double encodeMs = channel.encodeMs / frames, fanOutMs = channel.fanOutMs / frames;
+        printf("%5d spectators, %d NPCs: tick %.3f ms, per snapshot %.3f ms encode (%lld frames, %lld keyframes) and "
+               "%.3f ms fan out, %.2f us per spectator, %.1f kB/s out, %.0f packets/s\n",
+            (int)channel.spectators.size(), npcs, tickMs / ticks, encodeMs, channel.frames, channel.keyframes, fanOutMs,
+            fanOutMs * 1000.0 / count, (double)channel.bytesOut / seconds / 1000.0, (double)channel.packetsOut / seconds);
+        printf("      encoding for each viewer instead would take about %.1f ms per snapshot; watchers decoded %lld, "
+               "%lld undecodable, first picture after %.0f ms (from the start) and %.0f ms (joining late)\n",
+            encodeMs * count, decoded, undecodable, pictured[0] ? waitMs[0] / pictured[0] : -1.0,
+            pictured[1] ? waitMs[1] / pictured[1] : -1.0);
+        fflush(stdout);
+    }
+    return 0;
+}
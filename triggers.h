@@ -0,0 +1,102 @@
+#pragma once
+
+#include <raylib.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+// Cell size of the grid the triggers are bucketed into, roughly the size of a typical trigger
+constexpr float TRIGGER_CELL_SIZE = 4.0f;
+
+// An invisible box that reports bodies entering and leaving it (NPC talk zones, pickups, checkpoints...)
+// A body counts as inside when its center is inside the box
+struct Trigger {
+    Vector3 position;
+    Vector3 dimensions;
+    int tag = 0;              // Free for gameplay code to tell triggers apart
+    bool reportStay = false;  // Also report a Stay event every update while a body is inside
+};
+
+enum class TriggerEventType { Enter, Stay, Exit };
+
+struct TriggerEvent {
+    TriggerEventType type;
+    int trigger;  // Index into TriggerSystem::triggers
+    int body;     // Whatever id the caller passed to update()
+};
+
+struct TriggerSystem {
+    std::vector<Trigger> triggers;
+    // Trigger indices per grid cell, a trigger is listed in every cell it overlaps
+    std::unordered_map<long long, std::vector<int>> cells;
+    // Sorted trigger indices each body was inside after its last update
+    std::unordered_map<int, std::vector<int>> inside;
+    // Reused between updates so the per-body lists don't reallocate every frame
+    std::vector<int> scratch;
+
+    static long long cellKey(int cx, int cz) {
+        return ((long long)cx << 32) ^ (unsigned int)cz;
+    }
+
+    static int cellCoord(float v) {
+        return (int)floorf(v / TRIGGER_CELL_SIZE);
+    }
+
+    int add(const Trigger& trigger) {
+        int index = (int)triggers.size();
+        triggers.push_back(trigger);
+        Vector3 half = {trigger.dimensions.x * 0.5f, trigger.dimensions.y * 0.5f, trigger.dimensions.z * 0.5f};
+        for (int cx = cellCoord(trigger.position.x - half.x); cx <= cellCoord(trigger.position.x + half.x); cx++) {
+            for (int cz = cellCoord(trigger.position.z - half.z); cz <= cellCoord(trigger.position.z + half.z); cz++) {
+                cells[cellKey(cx, cz)].push_back(index);
+            }
+        }
+        return index;
+    }
+
+    bool contains(const Trigger& trigger, const Vector3& point) const {
+        return point.x > trigger.position.x - trigger.dimensions.x * 0.5f &&
+               point.x < trigger.position.x + trigger.dimensions.x * 0.5f &&
+               point.y > trigger.position.y - trigger.dimensions.y * 0.5f &&
+               point.y < trigger.position.y + trigger.dimensions.y * 0.5f &&
+               point.z > trigger.position.z - trigger.dimensions.z * 0.5f &&
+               point.z < trigger.position.z + trigger.dimensions.z * 0.5f;
+    }
+
+    // Checks one body against the triggers in its cell and appends Enter/Exit events for membership changes
+    // (plus Stay for triggers that ask for it). Only the triggers sharing the body's cell are tested.
+    void update(int body, const Vector3& position, std::vector<TriggerEvent>& events) {
+        std::vector<int>& now = scratch;
+        now.clear();
+        auto it = cells.find(cellKey(cellCoord(position.x), cellCoord(position.z)));
+        if (it != cells.end()) {
+            for (int index : it->second) {
+                if (contains(triggers[index], position)) now.push_back(index);
+            }
+            std::sort(now.begin(), now.end());
+        }
+
+        std::vector<int>& before = inside[body];
+        if (now.empty() && before.empty()) return;
+        // Both lists are sorted, walk them together
+        size_t i = 0, j = 0;
+        while (i < before.size() || j < now.size()) {
+            if (j == now.size() || (i < before.size() && before[i] < now[j])) {
+                events.push_back({TriggerEventType::Exit, before[i++], body});
+            } else if (i == before.size() || now[j] < before[i]) {
+                events.push_back({TriggerEventType::Enter, now[j++], body});
+            } else {
+                if (triggers[now[j]].reportStay) events.push_back({TriggerEventType::Stay, now[j], body});
+                i++;
+                j++;
+            }
+        }
+        before.swap(now);
+    }
+
+    // Drops a body's memberships without reporting exits (e.g. on respawn)
+    void forget(int body) {
+        inside.erase(body);
+    }
+};
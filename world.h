@@ -0,0 +1,449 @@
+#pragma once
+
+#include <raylib.h>
+#include <raymath.h>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cmath>
+#include <type_traits>
+
+#include "heightfield.h"
+
+// Downward acceleration applied to every body each step
+constexpr float GRAVITY_PULL = 10.5f;
+// A body this far below a collider's top still lands on it, float imprecision would miss landings otherwise
+constexpr float LANDING_EPS = 0.001f;
+// Collider tops this close to each other are checked by the ground contact shortcut, it falls back to the full pass
+// when a body resting on one would drop further than this in a step
+constexpr float CONTACT_NEAR_RANGE = 0.05f;
+
+// Remembers which collider a body came to rest on, so the next vertical pass can validate it first
+struct GroundContact {
+    int collider = -1;          // Index into World::colliders, -1 when not resting on anything
+    float restY = 0.0f;         // Body Y at which it rested on that collider
+    unsigned generation = 0;    // World::colliderGeneration at the time, stale once colliders change
+};
+
+struct Player {
+    // Constructor
+    Player(const Vector3& pos, const Vector3& dims)
+        : position(pos), dimensions(dims){}
+    // Members
+    Vector3 position;
+    Vector3 dimensions;
+    Color color = RED;
+    bool isResting = false;
+    GroundContact contact;
+
+};
+
+struct Collider {
+    Vector3 position;
+    Vector3 dimensions;
+    Color color;
+    // According to ChatGPT using const references is more efficient (though it doesn't matter that much right now)
+    Collider(const Vector3& pos, const Vector3& dims)
+    : position(pos), dimensions(dims), color(SKYBLUE) {}
+
+};
+
+// Sleep tuning: a body that rests and barely moves for SLEEP_STEPS steps in a row is put to sleep
+constexpr float SLEEP_MOVE_THRESHOLD = 0.001f;  // Max distance moved per step to count as still
+constexpr float SLEEP_SPEED_THRESHOLD = 0.01f;  // Max horizontal speed to count as still
+constexpr int SLEEP_STEPS = 30;
+constexpr float WAKE_RADIUS = 1.5f;             // Moving bodies wake sleepers within this distance
+constexpr float SLEEP_CELL_SIZE = 2.0f;         // Cell size of the grid used to find nearby sleepers
+
+// A simulated body other than the main player (NPCs, crowds...), owned by the World
+struct Actor {
+    Actor(const Vector3& pos, const Vector3& dims)
+        : body(pos, dims), nextPos(pos) {}
+    Player body;
+    Vector3 speed = {0.0f, 0.0f, 0.0f};
+    Vector3 nextPos;
+    Vector3 move = {0.0f, 0.0f, 0.0f};  // Desired horizontal velocity, set through World::applyInput
+    // Sleep state
+    bool sleeping = false;
+    int stillSteps = 0;
+    int awakeSlot = -1;                 // Index into World::awakeActors while awake
+    long long sleepCell = 0;            // Key into World::sleepers while sleeping
+};
+
+// Everything World::step() changes, kept flat so saving and restoring are a few memcpys into buffers that stay
+// allocated from one save to the next. The colliders and terrain aren't in it, they're the level.
+struct WorldState {
+    Player player{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+    Vector3 lastPlayerPos = {0.0f, 0.0f, 0.0f};
+    unsigned colliderGeneration = 0;
+    std::vector<Actor> actors;
+    std::vector<int> awakeActors;
+    std::vector<std::pair<long long, int>> sleepers;    // (cell, actor), each cell's actors in their order there
+};
+
+static_assert(std::is_trivially_copyable_v<Actor> && std::is_trivially_copyable_v<Player>,
+    "WorldState copies bodies as plain bytes");
+
+enum class Axis { X, Y, Z };
+
+// Pick one component of a vector at compile time, so the resolver below can be written once for every axis
+template<Axis A>
+constexpr float& component(Vector3& v) {
+    if constexpr (A == Axis::X) return v.x;
+    else if constexpr (A == Axis::Y) return v.y;
+    else return v.z;
+}
+
+template<Axis A>
+constexpr float component(const Vector3& v) {
+    if constexpr (A == Axis::X) return v.x;
+    else if constexpr (A == Axis::Y) return v.y;
+    else return v.z;
+}
+
+// Game world struct
+struct World {
+    // Constructor
+    World(std::vector<Collider>& colliders, Player& player)
+        : colliders(colliders), player(player) {}
+    // Members
+    std::vector<Collider>& colliders;
+    Player& player;
+    // Optional terrain, resolved after the box colliders
+    const Heightfield* terrain = nullptr;
+    // Bump through collidersChanged() whenever colliders are added, removed or moved
+    unsigned colliderGeneration = 0;
+    // By collider, the others whose top is within CONTACT_NEAR_RANGE of its own but not level with it. Those are the
+    // only ones that could land a body resting on it somewhere else. Rebuilt on first use after colliders change.
+    std::vector<std::vector<int>> nearTops;
+    unsigned nearTopsGeneration = 0;
+
+    // Actors and the bookkeeping that lets step() only touch the awake ones
+    std::vector<Actor> actors;
+    std::vector<int> awakeActors;
+    std::unordered_map<long long, std::vector<int>> sleepers;
+    Vector3 lastPlayerPos = {0.0f, 0.0f, 0.0f};
+
+    // Changed level geometry can pull the ground from under anyone, so wake everything up
+    void collidersChanged() {
+        colliderGeneration++;
+        wakeAll();
+    }
+
+    int addActor(const Vector3& pos, const Vector3& dims) {
+        actors.emplace_back(pos, dims);
+        int index = (int)actors.size() - 1;
+        actors[index].awakeSlot = (int)awakeActors.size();
+        awakeActors.push_back(index);
+        return index;
+    }
+
+    void applyInput(int index, const Vector3& move) {
+        Actor& actor = actors[index];
+        if (actor.move.x == move.x && actor.move.z == move.z) return;
+        actor.move = move;
+        wake(index);
+    }
+
+    // Moves one body for one step: X, Z, gravity, then Y
+    void stepBody(Player& body, Vector3& nextPos, Vector3& speed, float dt) {
+        body.isResting = false; // reset at the start of each, resolveY will determine whether jump allowed or not
+        // Handle lateral movement and collision
+        nextPos.x = body.position.x + speed.x * dt;
+        resolve<Axis::X>(body, nextPos, speed);
+        nextPos.z = body.position.z + speed.z * dt;
+        resolve<Axis::Z>(body, nextPos, speed);
+        // Handle vertical movement and collision
+        // Apply gravity
+        speed.y -= GRAVITY_PULL * dt;
+        nextPos.y = body.position.y + speed.y * dt;
+        resolve<Axis::Y>(body, nextPos, speed);
+    }
+
+    // Steps every awake actor, puts still ones to sleep and wakes sleepers near anything that moved
+    void step(float dt) {
+        if (Vector3DistanceSqr(player.position, lastPlayerPos) > SLEEP_MOVE_THRESHOLD * SLEEP_MOVE_THRESHOLD) {
+            wakeNear(player.position);
+        }
+        lastPlayerPos = player.position;
+
+        // Iterate over a copy, sleeping and waking reshuffle awakeActors
+        std::vector<int> active = awakeActors;
+        for (int index : active) {
+            Actor& actor = actors[index];
+            if (actor.sleeping) continue;
+            Vector3 before = actor.body.position;
+            actor.speed.x = actor.move.x;
+            actor.speed.z = actor.move.z;
+            stepBody(actor.body, actor.nextPos, actor.speed, dt);
+
+            bool moved = Vector3DistanceSqr(actor.body.position, before) > SLEEP_MOVE_THRESHOLD * SLEEP_MOVE_THRESHOLD;
+            if (moved) wakeNear(actor.body.position);
+            if (!moved && actor.body.isResting &&
+                fabsf(actor.speed.x) < SLEEP_SPEED_THRESHOLD &&
+                fabsf(actor.speed.z) < SLEEP_SPEED_THRESHOLD) {
+                if (++actor.stillSteps >= SLEEP_STEPS) sleep(index);
+            } else {
+                actor.stillSteps = 0;
+            }
+        }
+    }
+
+    static long long sleepCellKey(int cx, int cz) {
+        return ((long long)cx << 32) ^ (unsigned int)cz;
+    }
+
+    static int sleepCellCoord(float v) {
+        return (int)floorf(v / SLEEP_CELL_SIZE);
+    }
+
+    void sleep(int index) {
+        Actor& actor = actors[index];
+        // Swap remove from the awake list
+        int last = awakeActors.back();
+        awakeActors[actor.awakeSlot] = last;
+        actors[last].awakeSlot = actor.awakeSlot;
+        awakeActors.pop_back();
+        actor.awakeSlot = -1;
+
+        actor.sleeping = true;
+        actor.speed = {0.0f, 0.0f, 0.0f};
+        actor.sleepCell = sleepCellKey(sleepCellCoord(actor.body.position.x), sleepCellCoord(actor.body.position.z));
+        sleepers[actor.sleepCell].push_back(index);
+    }
+
+    void wake(int index) {
+        Actor& actor = actors[index];
+        actor.stillSteps = 0;
+        if (!actor.sleeping) return;
+        actor.sleeping = false;
+        std::vector<int>& cell = sleepers[actor.sleepCell];
+        for (size_t i = 0; i < cell.size(); i++) {
+            if (cell[i] == index) {
+                cell[i] = cell.back();
+                cell.pop_back();
+                break;
+            }
+        }
+        if (cell.empty()) sleepers.erase(actor.sleepCell);
+        actor.awakeSlot = (int)awakeActors.size();
+        awakeActors.push_back(index);
+    }
+
+    void wakeNear(const Vector3& pos) {
+        if (sleepers.empty()) return;
+        int minX = sleepCellCoord(pos.x - WAKE_RADIUS), maxX = sleepCellCoord(pos.x + WAKE_RADIUS);
+        int minZ = sleepCellCoord(pos.z - WAKE_RADIUS), maxZ = sleepCellCoord(pos.z + WAKE_RADIUS);
+        for (int cx = minX; cx <= maxX; cx++) {
+            for (int cz = minZ; cz <= maxZ; cz++) {
+                auto it = sleepers.find(sleepCellKey(cx, cz));
+                if (it == sleepers.end()) continue;
+                // Copy, waking edits the cell
+                std::vector<int> cell = it->second;
+                for (int index : cell) {
+                    if (Vector3DistanceSqr(actors[index].body.position, pos) <= WAKE_RADIUS * WAKE_RADIUS) wake(index);
+                }
+            }
+        }
+    }
+
+    void wakeAll() {
+        for (int i = 0; i < (int)actors.size(); i++) wake(i);
+    }
+
+    // The awake order and the order of sleepers in a cell decide the order things wake and sleep in, so they're
+    // kept as they are: a restored world steps exactly like the one that was saved
+    void save(WorldState& state) const {
+        state.player = player;
+        state.lastPlayerPos = lastPlayerPos;
+        state.colliderGeneration = colliderGeneration;
+        state.actors.assign(actors.begin(), actors.end());
+        state.awakeActors.assign(awakeActors.begin(), awakeActors.end());
+        state.sleepers.clear();
+        for (const auto& [cell, indices] : sleepers) {
+            for (int index : indices) state.sleepers.push_back({cell, index});
+        }
+    }
+
+    void restore(const WorldState& state) {
+        player = state.player;
+        lastPlayerPos = state.lastPlayerPos;
+        colliderGeneration = state.colliderGeneration;
+        actors.assign(state.actors.begin(), state.actors.end());
+        awakeActors.assign(state.awakeActors.begin(), state.awakeActors.end());
+        // Empty the cells rather than the map, so their storage gets reused
+        for (auto& [cell, indices] : sleepers) indices.clear();
+        for (const auto& [cell, index] : state.sleepers) sleepers[cell].push_back(index);
+        for (auto it = sleepers.begin(); it != sleepers.end(); ) {
+            if (it->second.empty()) it = sleepers.erase(it);
+            else ++it;
+        }
+    }
+
+    // Functions to resolve collision
+
+    // One resolver for all three axes. Axis A is the one being moved, U and V are the two we gate on.
+    // The differences between the axes used to be hand-copied loops, now they are compile time policy:
+    //  - X and Z gate on the next position of the other axes, Y gates on the current X/Z footprint
+    //    (which X and Z have already committed by the time Y runs) and on the next Y
+    //  - Z only blocks when actually moving towards the collider (speed sign check)
+    //  - Y lands with a small epsilon and marks the body as resting
+    template<Axis A>
+    void resolve(Player& body, Vector3& nextPos, Vector3& speed)
+    {
+        if constexpr (A == Axis::Y) {
+            if (resolveFromContact(body, nextPos, speed)) return;
+        }
+        constexpr Axis U = A == Axis::X ? Axis::Y : Axis::X;
+        constexpr Axis V = A == Axis::Z ? Axis::Y : Axis::Z;
+        constexpr bool gateOnCurrent = A == Axis::Y;
+        constexpr bool checkSpeedSign = A == Axis::Z;
+        // Need to use this for Y, otherwise imprecision will cause landing not to trigger when it should
+        constexpr float EPS = A == Axis::Y ? LANDING_EPS : 0.0f;
+
+        const Vector3 half = body.dimensions * 0.5f;
+        // Current max and min bounds for the body
+        const Vector3 maxPos = body.position + half;
+        const Vector3 minPos = body.position - half;
+        // Obtain the next max and min bounds of the body
+        const Vector3 nextMaxPos = nextPos + half;
+        const Vector3 nextMinPos = nextPos - half;
+        const Vector3& gateMax = gateOnCurrent ? maxPos : nextMaxPos;
+        const Vector3& gateMin = gateOnCurrent ? minPos : nextMinPos;
+
+        int landedOn = -1;
+        for (int i = 0; i < (int)colliders.size(); i++) {
+            const Collider& collider = colliders[i];
+            const Vector3 maxColliderPos = collider.position + collider.dimensions * 0.5f;
+            const Vector3 minColliderPos = collider.position - collider.dimensions * 0.5f;
+
+            // Gate on the two other axes
+            if (!(component<U>(gateMax) > component<U>(minColliderPos) &&
+                  component<U>(gateMin) < component<U>(maxColliderPos) &&
+                  component<V>(gateMax) > component<V>(minColliderPos) &&
+                  component<V>(gateMin) < component<V>(maxColliderPos))) continue;
+            // Y also requires the next position to overlap on its own axis
+            if constexpr (A == Axis::Y) {
+                if (!(component<A>(nextMaxPos) > component<A>(minColliderPos) &&
+                      component<A>(nextMinPos) < component<A>(maxColliderPos))) continue;
+            }
+
+            if ((!checkSpeedSign || component<A>(speed) > 0.0f) &&
+                component<A>(maxPos) <= component<A>(minColliderPos) && // Body still on the min side of the collider?
+                component<A>(nextMaxPos) > component<A>(minColliderPos) // Will next predicted position penetrate? (Approach vulnerable to tunneling)
+            ) {
+                component<A>(nextPos) = component<A>(minColliderPos) - component<A>(half); // If true, clamp nextPos to appropriate bounds
+                component<A>(speed) = 0.0f;
+            } else if (
+                (!checkSpeedSign || component<A>(speed) < 0.0f) &&
+                component<A>(minPos) >= component<A>(maxColliderPos) - EPS && // Body still on the max side?
+                component<A>(nextMinPos) < component<A>(maxColliderPos) // Will next predicted position penetrate?
+            ) {
+                component<A>(nextPos) = component<A>(maxColliderPos) + component<A>(half);
+                component<A>(speed) = 0.0f;
+                if constexpr (A == Axis::Y) {
+                    body.isResting = true;
+                    landedOn = i;
+                }
+            }
+        }
+        if (terrain) {
+            if constexpr (A == Axis::Y) {
+                // Land on the terrain, or get lifted onto it when walking uphill pushed the body slightly into the slope.
+                // Uses nextPos as the colliders left it, so a box standing above the terrain wins.
+                float ground = terrain->maxHeight(minPos.x, maxPos.x, minPos.z, maxPos.z);
+                if (minPos.y >= ground - TERRAIN_STEP_HEIGHT && nextPos.y - half.y < ground) {
+                    nextPos.y = ground + half.y;
+                    speed.y = 0.0f;
+                    body.isResting = true;
+                    landedOn = -1; // Terrain height changes as the body moves, nothing to cache
+                }
+            } else {
+                // Terrain rising more than a step in the way blocks like a wall
+                const Vector3 nextMin = nextPos - half;
+                const Vector3 nextMax = nextPos + half;
+                if (nextMin.y + TERRAIN_STEP_HEIGHT < terrain->maxHeight(nextMin.x, nextMax.x, nextMin.z, nextMax.z)) {
+                    component<A>(nextPos) = component<A>(body.position);
+                    component<A>(speed) = 0.0f;
+                }
+            }
+        }
+        component<A>(body.position) = component<A>(nextPos);
+        if constexpr (A == Axis::Y) {
+            body.contact = {landedOn, body.position.y, colliderGeneration};
+        }
+    }
+
+    // Sorts the collider tops once and pairs up the ones within CONTACT_NEAR_RANGE of each other. Level tops are
+    // skipped, landing on either puts a body at the same height, so a floor of equal tiles doesn't cost n squared.
+    void buildNearTops() {
+        nearTopsGeneration = colliderGeneration;
+        nearTops.assign(colliders.size(), {});
+        std::vector<std::pair<float, int>> byTop;
+        byTop.reserve(colliders.size());
+        for (int i = 0; i < (int)colliders.size(); i++) {
+            byTop.push_back({colliders[i].position.y + colliders[i].dimensions.y * 0.5f, i});
+        }
+        std::sort(byTop.begin(), byTop.end());
+        size_t higher = 0;  // First one above byTop[a]
+        for (size_t a = 0; a < byTop.size(); a++) {
+            while (higher < byTop.size() && byTop[higher].first <= byTop[a].first) higher++;
+            for (size_t b = higher; b < byTop.size() && byTop[b].first - byTop[a].first <= CONTACT_NEAR_RANGE; b++) {
+                nearTops[byTop[a].second].push_back(byTop[b].second);
+                nearTops[byTop[b].second].push_back(byTop[a].second);
+            }
+        }
+    }
+
+    // Fast path for the vertical pass: a body that rested on a collider last step and has neither moved vertically
+    // nor left that collider's footprint will just land on it again, so there is no need to scan every collider.
+    // Only covers gravity pulling the body down, jumps and anything else fall back to the full pass. So does a body
+    // over a neighbour whose top the full pass would land it on too, one just above the support (the landing
+    // epsilon) or just below it (within this step's fall): the last of those in collider order wins there, which
+    // the support alone can't tell. Gives exactly what the full pass would, resolver_check holds it to that.
+    bool resolveFromContact(Player& body, Vector3& nextPos, Vector3& speed)
+    {
+        const GroundContact& contact = body.contact;
+        if (contact.collider < 0 ||
+            contact.generation != colliderGeneration ||
+            body.position.y != contact.restY ||
+            nextPos.y >= body.position.y) return false;
+
+        const Collider& support = colliders[contact.collider];
+        const Vector3 half = body.dimensions * 0.5f;
+        const Vector3 maxPos = body.position + half;
+        const Vector3 minPos = body.position - half;
+        const Vector3 maxColliderPos = support.position + support.dimensions * 0.5f;
+        const Vector3 minColliderPos = support.position - support.dimensions * 0.5f;
+        if (!(maxPos.x > minColliderPos.x &&
+              minPos.x < maxColliderPos.x &&
+              maxPos.z > minColliderPos.z &&
+              minPos.z < maxColliderPos.z)) return false;
+        // The full pass's own landing test on the support, and how far the neighbours' tops have to be checked
+        const float nextMinY = nextPos.y - half.y;
+        const float nextMaxY = nextPos.y + half.y;
+        if (!(minPos.y >= maxColliderPos.y - LANDING_EPS && nextMinY < maxColliderPos.y && nextMaxY > minColliderPos.y) ||
+            maxColliderPos.y - nextMinY > CONTACT_NEAR_RANGE - LANDING_EPS) return false;
+        if (nearTopsGeneration != colliderGeneration || nearTops.size() != colliders.size()) buildNearTops();
+        for (int other : nearTops[contact.collider]) {
+            const Collider& neighbour = colliders[other];
+            const Vector3 maxOther = neighbour.position + neighbour.dimensions * 0.5f;
+            const Vector3 minOther = neighbour.position - neighbour.dimensions * 0.5f;
+            if (maxPos.x > minOther.x && minPos.x < maxOther.x && maxPos.z > minOther.z && minPos.z < maxOther.z &&
+                nextMaxY > minOther.y && nextMinY < maxOther.y && minPos.y >= maxOther.y - LANDING_EPS) return false;
+        }
+        // Terrain poking up above the support would lift the body
+        if (terrain && terrain->maxHeight(minPos.x, maxPos.x, minPos.z, maxPos.z) > contact.restY - half.y) return false;
+
+        nextPos.y = contact.restY;
+        speed.y = 0.0f;
+        body.isResting = true;
+        body.position.y = nextPos.y;
+        return true;
+    }
+
+    void resolveX(Vector3& nextPos, Vector3& speed) { resolve<Axis::X>(player, nextPos, speed); }
+    void resolveZ(Vector3& nextPos, Vector3& speed) { resolve<Axis::Z>(player, nextPos, speed); }
+    void resolveY(Vector3& nextPos, Vector3& speed) { resolve<Axis::Y>(player, nextPos, speed); }
+};